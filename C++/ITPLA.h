@@ -1,658 +1,2687 @@
-#ifndef __ITPLA_H__
-#define __ITPLA_H__
-
-#include <climits>
-#include <cassert>
-#include <cmath>
-#include <ctime>
-#include <cstdio>
-#include <iostream>
-#include <vector>
-
-#include <Box2D/Box2D.h>
-
-#include <CGAL/Exact_predicates_inexact_constructions_kernel.h>
-#include <CGAL/Segment_2.h>
-#include <CGAL/Polygon_2.h>
-#include <CGAL/Polygon_2_algorithms.h>
-#include <CGAL/intersections.h>
-#include <CGAL/Boolean_set_operations_2.h>
-
-#define Point b2Vec2
-#define Points std::vector<Point>
-#define Vector Point
-#define Vectors Points
-#define Point_2s vector<Point_2>
-#define ZERO 1e-9
-#define pi b2_pi
-#define to_rad(x) ((x) / 180.0 * pi)
-#define to_deg(x) ((x) * 180.0 / pi)
-typedef CGAL::Exact_predicates_inexact_constructions_kernel K;
-typedef CGAL::Point_2<K> Point_2;
-typedef CGAL::Vector_2<K> Vector_2;
-typedef CGAL::Polygon_2<K> Polygon_2;
-typedef CGAL::Triangle_2<K> Triangle_2;
-typedef CGAL::Segment_2<K> Segment_2;
-typedef CGAL::Ray_2<K> Ray_2;
-namespace ITPLA {
-using namespace std;
-
-void show_time(string info = "") {
-#if 1
-    fprintf(stdout, "[%9.3lf] %s\n", clock() * 1.0 / CLOCKS_PER_SEC, info.c_str());
-#endif
-}
-
-Points read(string filename) {
-    ifstream fin(filename);
-    Points ps;
-    for (Point p; fin >> p.x >> p.y; ps.push_back(p));
-    fin.close();
-    return ps;
-}
-
-Points test {
-    {0, 50},
-    {0, 0},
-//    {600, -100},
-    {400, 0},
-    {300, 300},
-    {200, 175},
-};
-Points LH {
-    {456.9322,30.508466},
-    {452.54237,66.949144},
-    {444.0678,116.101682},
-    {434.74576,165.254232},
-    {424.57627,205.084742},
-    {413.55932,238.983042},
-    {397.45763,275.423722},
-    {391.52542,288.135582},
-    {365.25424,338.983042},
-    {331.35593,290.677962},
-    {316.94915,272.033892},
-    {288.98305,238.983042},
-    {257.62712,203.389822},
-    {226.27119,176.271182},
-    {191.52542,148.305072},
-    {146.61017,118.644062},
-    {116.94915,100.847452},
-    {94.067797,90.677962},
-    {65.254237,77.11864},
-    {66.101695,30.50847},
-};
-Points tr1_1 {
-    {51.165254,78.305084},
-    {37.817797,224.23729},
-    {104.11017,231.35593},
-    {250.9322,236.25},
-    {395.97458,233.58051},
-    {386.63136,96.991525},
-    {382.62712,90.762712},
-    {369.72458,81.419491},
-    {317.66949,84.533898},
-    {208.66525,85.868644},
-    {104.11017,83.199152},
-};
-Points tr1_2 {
-    {134.36441,295.42373},
-    {23.58051,-31.58898},
-    {21.35593,-19.13136},
-    {22.69068,-17.3517},
-    {36.48305,-21.80084},
-    {27.13983,-11.5678},
-    {13.79237,-1.77966},
-    {11.12288,1.33475},
-    {12.01271,9.34322},
-    {7.11865,11.12288},
-    {2.22457,5.7839},
-    {4.44916,20.02118},
-    {9.34322,5.33898},
-    {158.83474,3.55933},
-    {2.66949,-115.67797},
-    {-212.22457,-2.22458},
-    {-28.02966,6.22882},
-    {-17.79661,6.22881},
-    {-17.3517,9.78814},
-    {-28.02966,18.68644},
-    {-26.25,20.02118},
-    {-44.93644,40.04238},
-    {-32.033899,35.59322}
-};
-Points tr1_4 {
-    {109.44915,133.91949},
-    {11.5678,131.25},
-    {83.64407,-7.11864},
-    {117.45762,-4.89407},
-    {142.8178,-1.77966},
-    {-2.66949,-129.02543},
-    {-120.57203,3.11441},
-    {-162.83899,5.33898},
-    {-10.23305,-1.33474},
-    {-6.67373,2.22457},
-    {-8.45339,-0.88983},
-    {-12.90254,0.44492}
-};
-Points tr1_5 {
-    {96.101695,257.16102},
-    {26.250005,35.1483},
-    {37.37288,30.69915},
-    {-2.6695,-14.6822},
-    {2.6695,-10.67797},
-    {5.33898,-12.01271},
-    {15.12712,-12.45762},
-    {17.79661,-6.22882},
-    {24.91525,-1.77966},
-    {37.37288,7.56356},
-    {23.1356,2.66949},
-    {32.47881,-0.44491},
-    {40.04237,-11.12288},
-    {30.69916,-13.79238},
-    {40.9322,-31.14407},
-    {31.58898,-39.15254},
-    {26.69492,-40.9322},
-    {-23.58051,-11.12288},
-    {-13.34746,-6.22882},
-    {-7.56356,-5.33898},
-    {-20.02118,-6.67373},
-    {-51.16526,-1.77966},
-    {-66.29237,6.67373},
-    {-47.16102,11.5678},
-    {-42.26695,17.35169},
-    {-38.70762,22.24576},
-    {-17.79661,14.68221},
-    {-22.69068,23.13559},
-    {-23.58051,28.02966}
-};
-
-Point rand_point(const Point &plb, const Point &prt) {
-    assert(plb.x <= prt.x && plb.y <= prt.y);
-    return Point((prt.x - plb.x) * rand() / RAND_MAX + plb.x, (prt.y - plb.y) * rand() / RAND_MAX + plb.y);
-}
-
-double normalize_angle(double angle) {  //-180~+180
-    while (180 < abs(angle))
-        if (0 < angle)
-            angle -= 360;
-        else
-            angle += 360;
-    return angle;
-}
-
-double angle_diff(double init, double fin) {
-    return normalize_angle(fin - init);
-}
-
-double distance_to_line(const Point &p, const Point &u, const Point &v) {
-    Vector e1 = u - v,
-           e2 = p - v;
-    return abs(e1.x * e2.y - e1.y * e2.x) / e1.Length();
-}
-
-Point normalize_point(const Point &p, const double edge_length) {
-    return Point(p.x / edge_length, p.y / edge_length);
-}
-
-Points normalize_polygon(const Points &polygon, const double edge_length) {
-    Points normalized_polygon;
-    for (int i = 0; i < polygon.size(); i++)
-        normalized_polygon.push_back(normalize_point(polygon[i], edge_length));
-    return normalized_polygon;
-}
-
-Point_2 convert_to_p2(const Point &p) {
-    return Point_2(p.x, p.y);
-}
-
-Vector_2 convert_to_v2(const Vector &v) {
-    return Vector_2(v.x, v.y);
-}
-
-Point_2s convert_to_p2s(const Points &polygon) {
-    Point_2s polygon_2;
-    for (int i = 0; i < polygon.size(); i++)
-        polygon_2.push_back(convert_to_p2(polygon[i]));
-    return polygon_2;
-}
-
-double area_polygon(const Points &polygon) {
-    Point_2s polygon_2 = convert_to_p2s(polygon);
-    return Polygon_2(polygon_2.begin(), polygon_2.end()).area();
-}
-
-bool in_polygon(const Points &polygon, const Point &p) {
-    Point_2s polygon_2 = convert_to_p2s(polygon);
-    Point_2 p_2 = convert_to_p2(p);
-    switch (CGAL::bounded_side_2(polygon_2.begin(), polygon_2.end(), p_2, K())) {
-        case CGAL::ON_BOUNDED_SIDE :
-          return true;
-        case CGAL::ON_BOUNDARY:
-          return false;
-        case CGAL::ON_UNBOUNDED_SIDE:
-          return false;
-    }
-}
-
-Triangle_2 create_triangle(const Point &c, const double arc) {
-    Point_2 p0 = convert_to_p2(c + Point(sin(to_rad(arc - 60)), cos(to_rad(arc - 60)))),
-            p1 = convert_to_p2(c + Point(sin(to_rad(arc - 180)), cos(to_rad(arc - 180)))),
-            p2 = convert_to_p2(c + Point(sin(to_rad(arc + 60)), cos(to_rad(arc + 60))));
-    return Triangle_2(p0, p1, p2);
-}
-
-Segment_2 create_segment(const Point &s1, const Point &s2) {
-    return Segment_2(convert_to_p2(s1), convert_to_p2(s2));
-}
-
-Ray_2 create_ray(const Point &p, const Vector &v) {
-    return Ray_2(convert_to_p2(p), convert_to_v2(v));
-}
-
-bool intersect_each(const Point &c1, const double a1, const Point &c2, const double a2) {
-    return CGAL::do_intersect(create_triangle(c1, a1), create_triangle(c2, a2));
-}
-
-bool intersect_each(const Point &c, const double a, const Point &s1, const Point &s2) {
-    return CGAL::do_intersect(create_triangle(c, a), create_segment(s1, s2));
-}
-
-int calc_direction(const Point &c, const double arc, const Point &p) {
-    Vector v = p - c;
-    for (int i = 0; i < 3; i++) {
-        double ai = arc + 120 * i;
-        Vector n = Point(sin(to_rad(ai)), cos(to_rad(ai)));
-        if (cos(to_rad(60)) * v.Length() <= v.x * n.x + v.y * n.y)
-            return i;
-    }
-    for (int i = 0; i < 3; i++) {
-        double ai = arc + 120 * i;
-        Vector n = Point(sin(to_rad(ai)), cos(to_rad(ai)));
-        if (cos(to_rad(70)) * v.Length() <= v.x * n.x + v.y * n.y)
-            return i;
-    }
-    exit(-1);
-}
-
-double calc_weight(const double dis, const double min_dis) {
-    return pow(dis / min_dis, -12);
-}
-
-double K, E = INT_MAX, pre_E, min_E = INT_MAX;
-int min_t = 0;
-int frame;
-vector<Point> min_p;
-vector<double> min_a;
-void save_status(const vector<b2Body *> &points, Vectors &v, vector<double> &a) {
-    v.clear();
-    a.clear();
-    for (int i = 0; i < points.size(); i++) {
-        b2Body *p = points[i];
-        v.push_back(p->GetPosition());
-        a.push_back(p->GetAngle());
-    }
-}
-
-void load_status(const vector<b2Body *> &points, const Vectors &v, const vector<double> &a) {
-    for (int i = 0; i < points.size(); i++) {
-        b2Body *p = points[i];
-        p->SetTransform(v[i] - p->GetPosition(), a[i] - p->GetAngle());
-    }
-}
-
-bool calc_next_step(const Points &normalized_polygon, /*const*/ vector<b2Body *> &points) {
-    bool ret = true;
-    vector<vector<int> > nearest_point(points.size(), vector<int>(3, -1)),
-                         overlap_module(points.size()),
-                         overlap_edge(points.size());
-    for (int i = 0; i < points.size(); i++) {
-        b2Body *p1 = points[i];
-
-        for (int j = 0; j < points.size(); j++)
-            if (i != j) {
-                b2Body *p2 = points[j];
-
-                int k = calc_direction(p1->GetPosition(), to_deg(p1->GetAngle()), p2->GetPosition());
-                if (nearest_point[i][k] == -1)
-                    nearest_point[i][k] = j;
-                else {
-                    b2Body *p3 = points[nearest_point[i][k]];
-                    if ((p2->GetPosition() - p1->GetPosition()).Length() < (p1->GetPosition() - p3->GetPosition()).Length())
-                        nearest_point[i][k] = j;
-                }
-
-                if (intersect_each(p1->GetPosition(), to_deg(p1->GetAngle()), p2->GetPosition(), to_deg(p2->GetAngle())))
-                    overlap_module[i].push_back(j);
-            }
-
-        for (int j = 0; j < normalized_polygon.size(); j++) {
-            const Point &s1 = normalized_polygon[j],
-                        &s2 = normalized_polygon[(j + 1) % normalized_polygon.size()];
-            if (intersect_each(p1->GetPosition(), to_deg(p1->GetAngle()), s1, s2))
-                overlap_edge[i].push_back(j);
-        }
-    }
-
-    Vectors force(points.size(), Point(0, 0));
-    vector<double> angle(points.size(), 0);
-    K = 1;
-    pre_E = E;
-    E = 0;
-    vector<pair<pair<int, double>, int> > del_rank;
-    for (int i = 0; i < points.size(); i++) {
-        del_rank.push_back(make_pair(make_pair(0.0, 0), i));
-        b2Body *p1 = points[i];
-
-        double weight_sum = 0;
-
-        for (int k = 0; k < 3; k++)
-            if (nearest_point[i][k] != -1) {
-                const double ak = to_deg(p1->GetAngle()) + k * 120;
-                const int &j = nearest_point[i][k];
-                b2Body *p2 = points[j];
-
-                Vector v = p2->GetPosition() - p1->GetPosition(),
-                       n = Point(sin(to_rad(ak)), cos(to_rad(ak))),
-                       t = Point(sin(to_rad(ak + 90)), cos(to_rad(ak + 90)));
-
-                Point p1_line_middle = 0.5 * n;
-                int l = calc_direction(p2->GetPosition(), to_deg(p2->GetAngle()), p1->GetPosition());
-
-                const double al = to_deg(p2->GetAngle()) + l * 120;
-                Vector n2 = Point(sin(to_rad(al)), cos(to_rad(al)));
-                Point p2_line_middle = v + 0.5 * n2;
-                double ang_diff = angle_diff(ak, al + 180);
-
-                double v_n_length = v.x * n.x + v.y * n.y,
-                       v_n2_length = - (v.x * n2.x + v.y * n2.y),
-                       p2_line_middle_t_length = p2_line_middle.x * t.x + p2_line_middle.y * t.y,
-                       min_distance = (0.5 + sin(to_rad(30 + abs(ang_diff)))) / (max(v_n_length, v_n2_length) / v.Length()),
-                       kr = 1 - pow(v.Length() / min_distance, -2),
-                       kt = 0.5 * p2_line_middle_t_length;
-                assert(0 <= v_n_length);
-                Vector r = 1 / v.Length() * v;
-                double weight = /*calc_weight(v.Length(), min_distance) + */calc_weight(min_distance, 2) + calc_weight(v.Length(), 2);//pow(v.Length() / min_distance, -2) + pow((p1_line_middle - p2_line_middle).Length() + 0.1, -2);
-                force[i] += weight * (kr * r + kt * t);
-                angle[i] += 0.5 * ang_diff * weight;
-                weight_sum += weight;
-                if ((p1_line_middle - p2_line_middle).Length() < 0.15)
-                    del_rank.back().first.first += 10;
-            }
-
-        for (int k = 0; k < overlap_module[i].size(); k++) {
-            const int &j = overlap_module[i][k];
-            b2Body *p2 = points[j];
-            double ak = calc_direction(p1->GetPosition(), to_deg(p1->GetAngle()), p2->GetPosition()) * 120 + to_deg(p1->GetAngle());
-
-            Vector v = p2->GetPosition() - p1->GetPosition(),
-                   n = Point(sin(to_rad(ak)), cos(to_rad(ak))),
-                   t = Point(sin(to_rad(ak + 90)), cos(to_rad(ak + 90)));
-
-            Point p1_line_middle = 0.5 * n;
-            int l = calc_direction(p2->GetPosition(), to_deg(p2->GetAngle()), p1->GetPosition());
-
-            const double al = to_deg(p2->GetAngle()) + l * 120;
-            Vector n2 = Point(sin(to_rad(al)), cos(to_rad(al)));
-            Point p2_line_middle = v + 0.5 * n2;
-            double ang_diff = angle_diff(ak, al + 180);
-
-            double v_n_length = v.x * n.x + v.y * n.y,
-                   v_n2_length = - (v.x * n2.x + v.y * n2.y),
-                   p2_line_middle_t_length = p2_line_middle.x * t.x + p2_line_middle.y * t.y,
-                   min_distance = (0.5 + sin(to_rad(30 + abs(ang_diff)))) / (max(v_n_length, v_n2_length) / v.Length()),
-                   kr = 1 - pow(v.Length() / min_distance, -2),
-                   kt = 0.5 * p2_line_middle_t_length;
-            assert(0 <= v_n_length);
-            Vector r = 1 / v.Length() * v;
-            if (!(v.Length() < min_distance))
-                printf("%lf, %lf\n", v.Length(), min_distance);
-            E += max(0.0, 1 / (v.Length() / min_distance) - 1);
-            K = min(K, v.Length() / min_distance);
-            del_rank.back().first.second -= max(0.0, 1 - v.Length() / min_distance);
-        }
-
-        for (int j = 0; j < overlap_edge[i].size(); j++) {
-            const Point &u = normalized_polygon[overlap_edge[i][j]],
-                        &v = normalized_polygon[(overlap_edge[i][j] + 1) % normalized_polygon.size()];
-            double dis = distance_to_line(p1->GetPosition(), u, v);
-            Vector n = Point(u.y - v.y, v.x - u.x);
-            n.Normalize();
-            n *= 4;
-            int k = -1;
-            double min_dist = INT_MAX;
-            for (int l = 0; l < 3; l++) {
-                const double al = to_deg(p1->GetAngle()) + l * 120;
-                Point t = p1->GetPosition() + 0.5 * Point(sin(to_rad(al)), cos(to_rad(al)));
-                double dist = distance_to_line(t, u, v);
-                if (dist < min_dist) {
-                    min_dist = dist;
-                    k = l;
-                }
-            }
-            assert(k != -1);
-            const double ak = to_deg(p1->GetAngle()) + k * 120;
-            double ang_diff = angle_diff(ak, 180 - to_deg(atan2(v.y - u.y, v.x - u.x)));
-            double min_distance = sin(to_rad(30 + abs(ang_diff)));
-
-            vector<Segment_2> box_2;
-            box_2.push_back(create_segment(u, v));
-            box_2.push_back(create_segment(u, u - n));
-            box_2.push_back(create_segment(v, v - n));
-            vector<pair<Point, Point> > box;
-            box.push_back(make_pair(u, v));
-            box.push_back(make_pair(u, u - n));
-            box.push_back(make_pair(v, v - n));
-
-            Points intersect_points;
-            for (int l = 0; l < 3; l++) {
-                double al = to_deg(p1->GetAngle()) + 120 * l;
-                Point t1 = p1->GetPosition() + Point(sin(to_rad(al - 60)), cos(to_rad(al - 60))),
-                      t2 = p1->GetPosition() + Point(sin(to_rad(al + 60)), cos(to_rad(al + 60)));
-                Vector vt = t2 - t1;
-                Segment_2 t = create_segment(t1, t2);
-                int intersect_num = 0;
-                bool iu = false, iv = false;
-                for (int m = 0; m < box.size(); m++)
-                    if (CGAL::do_intersect(t, box_2[m])) {
-                        Vector vm = box[m].second - box[m].first;
-                        double A1 = vt.y,
-                               B1 = -vt.x,
-                               C1 = -A1 * t1.x - B1 * t1.y,
-                               A2 = vm.y,
-                               B2 = -vm.x,
-                               C2 = -A2 * box[m].first.x - B2 * box[m].first.y,
-                               ix = (B1 * C2 - C1 * B2) / (A1 * B2 - A2 * B1),
-                               iy = (C1 * A2 - A1 * C2) / (A1 * B2 - A2 * B1);
-                        if ((u - Point(ix, iy)).Length() < ZERO)
-                            iu = true;
-                        else if ((v - Point(ix, iy)).Length() < ZERO)
-                            iv = true;
-                        else {
-                            intersect_num++;
-                            intersect_points.push_back(Point(ix, iy));
-                        }
-                    }
-                intersect_num += iu + iv;
-                if (intersect_num == 1)
-                    if ((v - u).x * (t1 - v).y - (v - u).y * (t1 - v).x < 0)
-                        intersect_points.push_back(t1);
-                    else
-                        intersect_points.push_back(t2);
-            }
-            double max_dis = 0;
-            for (int l = 0; l < intersect_points.size(); l++)
-                max_dis = max(max_dis, distance_to_line(intersect_points[l], u, v));
-//            printf("tmp:%lf", tmp);
-            min_distance = dis + max_dis;
-
-            double kn = 1 - pow(dis / min_distance, -2);
-            if (min_distance < dis)
-                printf("dis:%lf min_dis:%lf kn:%lf\n", dis, min_distance, kn);
-            if (0 < kn)
-                continue;
-            assert(ZERO < abs(n.Normalize()));
-            double weight = calc_weight(min_distance, 1) + calc_weight(dis, 1);//pow(min_dist + 0.2, -2);
-            force[i] -= weight * kn * n;
-            angle[i] += ang_diff * weight;
-            weight_sum += weight;
-            K = min(K, dis / min_distance);
-            if (min_dist < 0.1)
-                del_rank.back().first.first++;
-            del_rank.back().first.second -= max(0.0, 1 - dis / min_distance);
-            E += max(0.0, 1 / (dis / min_distance) - 1);
-        }
-
-        if (ZERO < weight_sum) {
-            force[i] *= 1 / weight_sum;
-            angle[i] /= weight_sum;
-        }
-    }
-    E /= 2;
-
-    for (int i = 0; i < points.size(); i++) {
-        b2Body *p = points[i];
-        p->SetLinearVelocity(force[i]);
-        p->SetAngularVelocity(to_rad(angle[i]));
-    }
-
-    sort(del_rank.begin(), del_rank.end());
-    double sum = 0;
-    for (int i = 0; i < del_rank.size(); i++)
-        sum += del_rank[i].first.second;
-    int del = -1;
-    for (int i = 0; i < del_rank.size() && del == -1; i++)
-        if (abs(sum / del_rank.size()) <= abs(del_rank[i].first.second))
-            del = del_rank[i].second;
-    static pair<int, int> pre_del(-1, 0);
-    if (pre_del.first == del)
-        pre_del.second++;
-    else
-        pre_del = pair<int, int>(del, 1);
-    if (frame % 10000 == 0) {
-        show_time();
-        cout << frame << endl;
-    }
-    static int pause_time = 0;
-    if (E < min_E) {
-        min_t = 0;
-//        min_p.clear();
-//        min_a.clear();
-//        for (int i = 0; i < points.size(); i++) {
-//            b2Body *p = points[i];
-//            min_p.push_back(p->GetPosition());
-//            min_a.push_back(p->GetAngle());
-//        }
-    } else
-        min_t++;
-    min_E = min(min_E, E);
-    pause_time += exp(1 - E / pre_E) < (double)rand() / RAND_MAX;
-//    cerr << frame << ", " << points.size() << ", " << E << endl;
-//    if ((/*K > 0.95||*/frame > 60001+100)&&INT_MAX && frame--)
-//        for (int i = 0; i < points.size(); i++) {
-//            b2Body *p = points[i];
-//            p->SetLinearVelocity(Vector(0, 0));
-//            p->SetAngularVelocity(0);
-//        }
-    if (pre_del.first != -1 && (pow(points.size(), 2) < pause_time || 120*60 < min_t)) {
-        if (K < .85) {
-            pre_del.second = 0;
-            pause_time = 0;
-            pre_E = INT_MAX;
-            min_E = INT_MAX;
-            min_t = 0;
-            points.back()->GetWorld()->DestroyBody(points[del]);
-            points[del] = points.back();
-            points.pop_back();
-        } else
-            ret = false;
-        for (int i = 0; i < points.size(); i++) {
-            b2Body *p = points[i];
-            p->SetLinearVelocity(Vector(0, 0));
-            p->SetAngularVelocity(0);
-        }
-    } else
-        frame++;
-    return ret;
-}
-
-const int xxx = -1;//10;
-time_t stime = -1;//1427351926;//1427343294;//1427288939;//1427024809;//-1;//1427015316;//-1;//1426931542;//-1;//1426923739;//1426605903;//1425904342;//-1;//1425813081;//-1;//1425746144;//-1;//1425641876;
-vector<b2Body *>/*pair<Points, vector<double> >*/ place(const Points &polygon, double edge_length) {
-    assert(2 < polygon.size());
-    const Points normalized_polygon = normalize_polygon(polygon, edge_length / sqrt(3));
-
-    show_time();
-    printf("start place ...\n");
-    Point plb = normalized_polygon[0],
-          prt = normalized_polygon[0];
-    for (int i = 1; i < normalized_polygon.size(); i++) {
-        const Point &p = normalized_polygon[i];
-        plb.x = min(plb.x, p.x);
-        plb.y = min(plb.y, p.y);
-        prt.x = max(prt.x, p.x);
-        prt.y = max(prt.y, p.y);
-    }
-    printf("(%lf, %lf)<->(%lf, %lf)\n", plb.x, plb.y, prt.x, prt.y);
-
-    stime = (stime != -1 ? stime : time(NULL));
-    srand(stime);//time(NULL));
-
-    double area = area_polygon(normalized_polygon);
-    printf("accurate area = %.6lf\n", area);
-
-    show_time();
-    printf("create world ...\n", area);
-    Vector gravity(0, 0);
-    b2World *world = new b2World(gravity);
-
-    b2BodyDef border_def;
-    border_def.position.Set(0, 0);
-    b2Body *border = world->CreateBody(&border_def);
-    for (int i = 0; i < normalized_polygon.size(); i++) {
-        const Point &u = normalized_polygon[i],
-                    &v = normalized_polygon[(i + 1) % normalized_polygon.size()];
-        b2EdgeShape border_edge_shape;
-        border_edge_shape.Set(u, v);
-        b2Fixture *border_edge_fixture = border->CreateFixture(&border_edge_shape, 0);
-        border_edge_fixture->SetFriction(0);
-        border_edge_fixture->SetRestitution(0);
-    }
-
-    int point_number = xxx == -1 ? int(area / (3 * sqrt(3) / 4)) : xxx;
-    vector<b2Body *> points(point_number, NULL);
-    for (int i = 0; i < points.size(); i++) {
-        Point p;
-        while (!in_polygon(normalized_polygon, p = rand_point(plb, prt)));
-
-        b2BodyDef point_def;
-        point_def.type = b2_dynamicBody;
-        point_def.position.Set(p.x, p.y);
-        point_def.angle = 2 * pi * rand() / RAND_MAX;
-        points[i] = world->CreateBody(&point_def);
-        b2CircleShape point_shape;
-        point_shape.m_p.Set(0, 0);
-        point_shape.m_radius = 0.1;
-        points[i]->CreateFixture(&point_shape, 1);
-    }
-
-    show_time();
-    printf("start evolove ...\n");
-
-/*    float32 timeStep = 1.0f / 60.0f;
-    int32 velocityIterations = 6;
-    int32 positionIterations = 2;
-
-    for (int i = 0; i < 600; i++) {
-        calc_next_step(points);
-        world->Step(timeStep, velocityIterations, positionIterations);
-    }
-*/
-    show_time();
-    printf("end evolove\n");
-    printf("contain %d points\n", points.size());
-    printf("stime = %d\n", stime);
-    return points;
-}
-
-}
-
-#endif // __ITPLA_H__
+#ifndef __ITPLA_H__
+#define __ITPLA_H__
+
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <cassert>
+#include <cmath>
+#include <ctime>
+#include <cstdio>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#ifndef ITPLA_NO_BOX2D
+#include <Box2D/Box2D.h>
+#else
+// built without Box2D: the few vector operations the solver uses, with the same float precision
+typedef float float32;
+#define b2_pi 3.14159265359f
+#define b2_maxTranslation 2.0f
+#define b2_maxRotation (0.5f * b2_pi)
+struct b2Vec2 {
+    float32 x, y;
+    b2Vec2() {}
+    b2Vec2(float32 x, float32 y) : x(x), y(y) {}
+    void SetZero() { x = y = 0; }
+    void Set(float32 x_, float32 y_) { x = x_; y = y_; }
+    b2Vec2 operator-() const { return b2Vec2(-x, -y); }
+    void operator+=(const b2Vec2 &v) { x += v.x; y += v.y; }
+    void operator-=(const b2Vec2 &v) { x -= v.x; y -= v.y; }
+    void operator*=(float32 a) { x *= a; y *= a; }
+    float32 Length() const { return std::sqrt(x * x + y * y); }
+    float32 LengthSquared() const { return x * x + y * y; }
+    float32 Normalize() {
+        float32 length = Length();
+        if (length < 1.19209290e-7f)
+            return 0;
+        float32 inv_length = 1.0f / length;
+        x *= inv_length;
+        y *= inv_length;
+        return length;
+    }
+};
+inline b2Vec2 operator+(const b2Vec2 &a, const b2Vec2 &b) { return b2Vec2(a.x + b.x, a.y + b.y); }
+inline b2Vec2 operator-(const b2Vec2 &a, const b2Vec2 &b) { return b2Vec2(a.x - b.x, a.y - b.y); }
+inline b2Vec2 operator*(float32 s, const b2Vec2 &a) { return b2Vec2(s * a.x, s * a.y); }
+inline bool operator==(const b2Vec2 &a, const b2Vec2 &b) { return a.x == b.x && a.y == b.y; }
+#endif
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include <CGAL/Exact_predicates_inexact_constructions_kernel.h>
+#include <CGAL/Segment_2.h>
+#include <CGAL/Polygon_2.h>
+#include <CGAL/Polygon_2_algorithms.h>
+#include <CGAL/intersections.h>
+#include <CGAL/Boolean_set_operations_2.h>
+
+#define Point b2Vec2
+#define Points std::vector<Point>
+#define Vector Point
+#define Vectors Points
+#define Point_2s vector<Point_2>
+#define ZERO 1e-9
+#define TIME_STEP (1.0 / 60)
+#define pi b2_pi
+#define to_rad(x) ((x) / 180.0 * pi)
+#define to_deg(x) ((x) * 180.0 / pi)
+typedef CGAL::Exact_predicates_inexact_constructions_kernel K;
+typedef CGAL::Point_2<K> Point_2;
+typedef CGAL::Polygon_2<K> Polygon_2;
+typedef CGAL::Triangle_2<K> Triangle_2;
+typedef CGAL::Segment_2<K> Segment_2;
+namespace ITPLA {
+using namespace std;
+
+void show_time(string info = "") {
+#if 1
+    fprintf(stdout, "[%9.3lf] %s\n", clock() * 1.0 / CLOCKS_PER_SEC, info.c_str());
+#endif
+}
+
+typedef chrono::steady_clock Clock;
+
+// seconds since t, and moves t to now
+double lap(Clock::time_point &t) {
+    Clock::time_point now = Clock::now();
+    double seconds = chrono::duration<double>(now - t).count();
+    t = now;
+    return seconds;
+}
+
+// fine grained timers and counters of one placement run, only filled in builds with ITPLA_PROFILE
+struct Profile {
+    enum Timer { grid, neighbour, module_overlap, edge_overlap, forces, annealing, integrate, timers };
+    // the misses are overlapping pairs that the touching distance still reports as apart, rejections are inserted
+    // modules taken out again because they did not settle in
+    enum Counter { frames, evaluated, pair_tests, module_hits, edge_tests, edge_hits, module_misses, edge_misses, deletions, insertions, rejections, counters };
+
+    double time[timers] = {};
+    long long count[counters] = {};
+    // CGAL is only reached through free functions, so its calls are counted for the whole process
+    static atomic<long long> cgal_calls;
+
+    static const char *timer_name(const int timer) {
+        static const char *names[timers] = {"grid", "neighbour", "module_overlap", "edge_overlap", "forces", "annealing", "integrate"};
+        return names[timer];
+    }
+
+    static const char *counter_name(const int counter) {
+        static const char *names[counters] = {"frames", "evaluated", "pair_tests", "module_hits", "edge_tests", "edge_hits", "module_misses", "edge_misses", "deletions", "insertions", "rejections"};
+        return names[counter];
+    }
+
+    void write_json(FILE *fout) const {
+        fprintf(fout, "{\n  \"seconds\": {");
+        for (int i = 0; i < timers; i++)
+            fprintf(fout, "%s\n    \"%s\": %.6lf", i ? "," : "", timer_name(i), time[i]);
+        fprintf(fout, "\n  },\n  \"counts\": {");
+        for (int i = 0; i < counters; i++)
+            fprintf(fout, "%s\n    \"%s\": %lld", i ? "," : "", counter_name(i), count[i]);
+        fprintf(fout, ",\n    \"cgal_calls\": %lld\n  }\n}\n", cgal_calls.load());
+    }
+
+    void write_csv(FILE *fout) const {
+        fprintf(fout, "kind,name,value\n");
+        for (int i = 0; i < timers; i++)
+            fprintf(fout, "seconds,%s,%.6lf\n", timer_name(i), time[i]);
+        for (int i = 0; i < counters; i++)
+            fprintf(fout, "count,%s,%lld\n", counter_name(i), count[i]);
+        fprintf(fout, "count,cgal_calls,%lld\n", cgal_calls.load());
+    }
+};
+atomic<long long> Profile::cgal_calls(0);
+
+// adds the time until the end of the scope to one timer
+struct ProfileScope {
+    double &time;
+    Clock::time_point start;
+    ProfileScope(Profile &profile, const Profile::Timer timer) : time(profile.time[timer]), start(Clock::now()) {}
+    ~ProfileScope() { time += lap(start); }
+};
+
+// splits a stretch of code into consecutive phases
+struct ProfileLaps {
+    Profile &profile;
+    Clock::time_point start;
+    ProfileLaps(Profile &profile) : profile(profile), start(Clock::now()) {}
+    void lap(const Profile::Timer timer) { profile.time[timer] += ITPLA::lap(start); }
+};
+
+#ifdef ITPLA_PROFILE
+#define PROFILE_SCOPE(profile, timer) ProfileScope profile_scope(profile, Profile::timer)
+#define PROFILE_LAPS(profile) ProfileLaps profile_laps(profile)
+#define PROFILE_LAP(timer) profile_laps.lap(Profile::timer)
+// also used from inside OpenMP loops
+#define PROFILE_COUNT(profile, counter, n) do { _Pragma("omp atomic") profile.count[Profile::counter] += (n); } while (0)
+#define PROFILE_CGAL() Profile::cgal_calls++
+#else
+#define PROFILE_SCOPE(profile, timer)
+#define PROFILE_LAPS(profile)
+#define PROFILE_LAP(timer)
+#define PROFILE_COUNT(profile, counter, n) do { } while (0)
+#define PROFILE_CGAL()
+#endif
+
+Points read(string filename) {
+    ifstream fin(filename);
+    Points ps;
+    for (Point p; fin >> p.x >> p.y; ps.push_back(p));
+    fin.close();
+    return ps;
+}
+
+Points test {
+    {0, 50},
+    {0, 0},
+//    {600, -100},
+    {400, 0},
+    {300, 300},
+    {200, 175},
+};
+Points LH {
+    {456.9322,30.508466},
+    {452.54237,66.949144},
+    {444.0678,116.101682},
+    {434.74576,165.254232},
+    {424.57627,205.084742},
+    {413.55932,238.983042},
+    {397.45763,275.423722},
+    {391.52542,288.135582},
+    {365.25424,338.983042},
+    {331.35593,290.677962},
+    {316.94915,272.033892},
+    {288.98305,238.983042},
+    {257.62712,203.389822},
+    {226.27119,176.271182},
+    {191.52542,148.305072},
+    {146.61017,118.644062},
+    {116.94915,100.847452},
+    {94.067797,90.677962},
+    {65.254237,77.11864},
+    {66.101695,30.50847},
+};
+Points tr1_1 {
+    {51.165254,78.305084},
+    {37.817797,224.23729},
+    {104.11017,231.35593},
+    {250.9322,236.25},
+    {395.97458,233.58051},
+    {386.63136,96.991525},
+    {382.62712,90.762712},
+    {369.72458,81.419491},
+    {317.66949,84.533898},
+    {208.66525,85.868644},
+    {104.11017,83.199152},
+};
+Points tr1_2 {
+    {134.36441,295.42373},
+    {23.58051,-31.58898},
+    {21.35593,-19.13136},
+    {22.69068,-17.3517},
+    {36.48305,-21.80084},
+    {27.13983,-11.5678},
+    {13.79237,-1.77966},
+    {11.12288,1.33475},
+    {12.01271,9.34322},
+    {7.11865,11.12288},
+    {2.22457,5.7839},
+    {4.44916,20.02118},
+    {9.34322,5.33898},
+    {158.83474,3.55933},
+    {2.66949,-115.67797},
+    {-212.22457,-2.22458},
+    {-28.02966,6.22882},
+    {-17.79661,6.22881},
+    {-17.3517,9.78814},
+    {-28.02966,18.68644},
+    {-26.25,20.02118},
+    {-44.93644,40.04238},
+    {-32.033899,35.59322}
+};
+Points tr1_4 {
+    {109.44915,133.91949},
+    {11.5678,131.25},
+    {83.64407,-7.11864},
+    {117.45762,-4.89407},
+    {142.8178,-1.77966},
+    {-2.66949,-129.02543},
+    {-120.57203,3.11441},
+    {-162.83899,5.33898},
+    {-10.23305,-1.33474},
+    {-6.67373,2.22457},
+    {-8.45339,-0.88983},
+    {-12.90254,0.44492}
+};
+Points tr1_5 {
+    {96.101695,257.16102},
+    {26.250005,35.1483},
+    {37.37288,30.69915},
+    {-2.6695,-14.6822},
+    {2.6695,-10.67797},
+    {5.33898,-12.01271},
+    {15.12712,-12.45762},
+    {17.79661,-6.22882},
+    {24.91525,-1.77966},
+    {37.37288,7.56356},
+    {23.1356,2.66949},
+    {32.47881,-0.44491},
+    {40.04237,-11.12288},
+    {30.69916,-13.79238},
+    {40.9322,-31.14407},
+    {31.58898,-39.15254},
+    {26.69492,-40.9322},
+    {-23.58051,-11.12288},
+    {-13.34746,-6.22882},
+    {-7.56356,-5.33898},
+    {-20.02118,-6.67373},
+    {-51.16526,-1.77966},
+    {-66.29237,6.67373},
+    {-47.16102,11.5678},
+    {-42.26695,17.35169},
+    {-38.70762,22.24576},
+    {-17.79661,14.68221},
+    {-22.69068,23.13559},
+    {-23.58051,28.02966}
+};
+
+double rand_unit(mt19937 &rng) {  //0~1
+    return rng() * 1.0 / mt19937::max();
+}
+
+double normalize_angle(double angle) {  //-180~+180
+    while (180 < abs(angle))
+        if (0 < angle)
+            angle -= 360;
+        else
+            angle += 360;
+    return angle;
+}
+
+double angle_diff(double init, double fin) {
+    return normalize_angle(fin - init);
+}
+
+double distance_to_line(const Point &p, const Point &u, const Point &v) {
+    Vector e1 = u - v,
+           e2 = p - v;
+    return abs(e1.x * e2.y - e1.y * e2.x) / e1.Length();
+}
+
+Point normalize_point(const Point &p, const double edge_length) {
+    return Point(p.x / edge_length, p.y / edge_length);
+}
+
+Points normalize_polygon(const Points &polygon, const double edge_length) {
+    Points normalized_polygon;
+    for (int i = 0; i < polygon.size(); i++)
+        normalized_polygon.push_back(normalize_point(polygon[i], edge_length));
+    return normalized_polygon;
+}
+
+Point_2 convert_to_p2(const Point &p) {
+    return Point_2(p.x, p.y);
+}
+
+Point_2s convert_to_p2s(const Points &polygon) {
+    Point_2s polygon_2;
+    for (int i = 0; i < polygon.size(); i++)
+        polygon_2.push_back(convert_to_p2(polygon[i]));
+    return polygon_2;
+}
+
+double area_polygon(const Points &polygon) {
+    PROFILE_CGAL();
+    Point_2s polygon_2 = convert_to_p2s(polygon);
+    return Polygon_2(polygon_2.begin(), polygon_2.end()).area();
+}
+
+// border given as a start point followed by offsets (tr1_2, tr1_4, tr1_5)
+Points accumulate_polygon(const Points &polygon) {
+    Points accumulated_polygon = polygon;
+    for (int i = 1; i < accumulated_polygon.size(); i++)
+        accumulated_polygon[i] += accumulated_polygon[i - 1];
+    return accumulated_polygon;
+}
+
+// place() and the edge forces expect a counterclockwise border
+Points orient_polygon(const Points &polygon) {
+    Points oriented_polygon = polygon;
+    if (area_polygon(polygon) < 0)
+        reverse(oriented_polygon.begin(), oriented_polygon.end());
+    return oriented_polygon;
+}
+
+// ear clipping of a counterclockwise simple polygon, three vertex indices per triangle
+vector<int> triangulate_polygon(const Points &polygon) {
+    vector<int> triangles, rest;
+    for (int i = 0; i < polygon.size(); i++)
+        rest.push_back(i);
+    auto cross = [&](const int a, const int b, const int c) {
+        const Point &pa = polygon[a], &pb = polygon[b], &pc = polygon[c];
+        return double(pb.x - pa.x) * (pc.y - pa.y) - double(pb.y - pa.y) * (pc.x - pa.x);
+    };
+    while (3 <= rest.size()) {
+        const int n = rest.size();
+        int ear = -1;
+        for (int i = 0; i < n && ear == -1; i++) {
+            const int a = rest[(i + n - 1) % n], b = rest[i], c = rest[(i + 1) % n];
+            if (cross(a, b, c) <= 0)
+                continue;
+            bool empty = true;
+            for (int j = 0; j < n && empty; j++) {
+                const int d = rest[j];
+                if (d != a && d != b && d != c)
+                    empty = !(0 <= cross(a, b, d) && 0 <= cross(b, c, d) && 0 <= cross(c, a, d));
+            }
+            if (empty)
+                ear = i;
+        }
+        // only collinear or (through rounding) no clean ears left: cut the most convex corner
+        if (ear == -1) {
+            double best = -1;
+            for (int i = 0; i < n; i++) {
+                double c = cross(rest[(i + n - 1) % n], rest[i], rest[(i + 1) % n]);
+                if (best < c) {
+                    best = c;
+                    ear = i;
+                }
+            }
+            if (ear == -1)
+                break;
+        }
+        triangles.push_back(rest[(ear + n - 1) % n]);
+        triangles.push_back(rest[ear]);
+        triangles.push_back(rest[(ear + 1) % n]);
+        rest.erase(rest.begin() + ear);
+    }
+    return triangles;
+}
+
+Segment_2 create_segment(const Point &s1, const Point &s2) {
+    return Segment_2(convert_to_p2(s1), convert_to_p2(s2));
+}
+
+// module shape: a regular polygon with N sides and circumradius 1 in normalized units. Geometry, the kernels and
+// Placer take N as a template argument, so every per-side loop has a fixed trip count; the tools build the one
+// picked with DEFINES += MODULE_SIDES=4 (squares) or 6 (hexagons). Side k has its outward normal at the module
+// angle + k * side_angle and runs between corners side_corner[k][0] and [1], corner k sits at -(2k + 1) * 180 / N
+#ifndef MODULE_SIDES
+#define MODULE_SIDES 3
+#endif
+#define SIDES MODULE_SIDES
+
+template <int N>
+struct Shape {
+    double apothem, edge, area, side_angle;
+    // (cos, sin) of the side normal and corner headings relative to the module angle
+    double normal_turn[N][2], corner_turn[N][2];
+    int side_corner[N][2];
+
+    Shape() {
+        // long double and snapped zeros reproduce the exact sqrt(3) / 2, 0.5 and 1 of the triangle tables
+        const long double pi_l = 3.141592653589793238462643383279502884L;
+        apothem = cosl(pi_l / N);
+        edge = 2 * sinl(pi_l / N);
+        area = N * sinl(2 * pi_l / N) / 2;
+        side_angle = 360.0 / N;
+        for (int k = 0; k < N; k++) {
+            set_turn(normal_turn[k], pi_l * 2 * k / N);
+            set_turn(corner_turn[k], -pi_l * (2 * k + 1) / N);
+            side_corner[k][0] = (N - k) % N;
+            side_corner[k][1] = (N - k - 1) % N;
+        }
+    }
+
+private:
+    static void set_turn(double *turn, const long double a) {
+        turn[0] = abs(cosl(a)) < 1e-15 ? 0 : double(cosl(a));
+        turn[1] = abs(sinl(a)) < 1e-15 ? 0 : double(sinl(a));
+    }
+};
+
+// the tables of each side count, built on first use
+template <int N>
+const Shape<N> &shape_of() {
+    static const Shape<N> shape;
+    return shape;
+}
+
+// true if the projections of a[0..na) and b[0..nb) onto the normal of u->v are disjoint
+inline bool separated_by(const Point &u, const Point &v, const Point *a, const int na, const Point *b, const int nb) {
+    const double nx = u.y - v.y,
+                 ny = v.x - u.x;
+    double min_a = INFINITY, max_a = -INFINITY, min_b = INFINITY, max_b = -INFINITY;
+    for (int i = 0; i < na; i++) {
+        double d = nx * a[i].x + ny * a[i].y;
+        min_a = min(min_a, d);
+        max_a = max(max_a, d);
+    }
+    for (int i = 0; i < nb; i++) {
+        double d = nx * b[i].x + ny * b[i].y;
+        min_b = min(min_b, d);
+        max_b = max(max_b, d);
+    }
+    return max_a < min_b || max_b < min_a;
+}
+
+// separating axis tests, closed shapes: touching counts as overlapping as in CGAL::do_intersect
+template <int N>
+inline bool overlap_modules(const Point *a, const Point *b) {
+    for (int i = 0; i < N; i++)
+        if (separated_by(a[i], a[(i + 1) % N], a, N, b, N) || separated_by(b[i], b[(i + 1) % N], a, N, b, N))
+            return false;
+    return true;
+}
+
+template <int N>
+inline bool overlap_module_segment(const Point *a, const Point &s1, const Point &s2) {
+    const Point s[2] = {s1, s2};
+    for (int i = 0; i < N; i++)
+        if (separated_by(a[i], a[(i + 1) % N], a, N, s, 2))
+            return false;
+    return !separated_by(s1, s2, a, N, s, 2);
+}
+
+inline double orientation(const Point &u, const Point &v, const Point &p) {
+    return (double(v.x) - u.x) * (double(p.y) - u.y) - (double(v.y) - u.y) * (double(p.x) - u.x);
+}
+
+inline bool on_segment(const Point &u, const Point &v, const Point &p) {
+    return min(u.x, v.x) <= p.x && p.x <= max(u.x, v.x) && min(u.y, v.y) <= p.y && p.y <= max(u.y, v.y);
+}
+
+inline bool overlap_segments(const Point &p1, const Point &p2, const Point &q1, const Point &q2) {
+    double d1 = orientation(p1, p2, q1),
+           d2 = orientation(p1, p2, q2),
+           d3 = orientation(q1, q2, p1),
+           d4 = orientation(q1, q2, p2);
+    if (((0 < d1 && d2 < 0) || (d1 < 0 && 0 < d2)) && ((0 < d3 && d4 < 0) || (d3 < 0 && 0 < d4)))
+        return true;
+    return (d1 == 0 && on_segment(p1, p2, q1)) || (d2 == 0 && on_segment(p1, p2, q2))
+        || (d3 == 0 && on_segment(q1, q2, p1)) || (d4 == 0 && on_segment(q1, q2, p2));
+}
+
+#ifdef ITPLA_CHECK_KERNELS
+// compare the closed-form kernels with CGAL on every call
+#define check_kernel(fast, exact) do { \
+    PROFILE_CGAL(); \
+    if ((fast) != (exact)) fprintf(stderr, "%s:%d kernel disagrees with CGAL\n", __FILE__, __LINE__); \
+} while (0)
+#else
+#define check_kernel(fast, exact) do { } while (0)
+#endif
+
+// CGAL side of the kernel checks: a module as the fan of triangles from its first corner
+Triangle_2 fan_triangle(const Point *t, const int k) {
+    return Triangle_2(convert_to_p2(t[0]), convert_to_p2(t[k + 1]), convert_to_p2(t[k + 2]));
+}
+
+template <int N, class T>
+bool fan_intersect(const Point *t, const T &other) {
+    for (int k = 0; k + 2 < N; k++)
+        if (CGAL::do_intersect(fan_triangle(t, k), other))
+            return true;
+    return false;
+}
+
+template <int N>
+bool fan_intersect(const Point *t1, const Point *t2) {
+    for (int k = 0; k + 2 < N; k++)
+        if (fan_intersect<N>(t1, fan_triangle(t2, k)))
+            return true;
+    return false;
+}
+
+template <int N>
+bool intersect_each(const Point *t1, const Point *t2) {
+    bool ret = overlap_modules<N>(t1, t2);
+    check_kernel(ret, fan_intersect<N>(t1, t2));
+    return ret;
+}
+
+template <int N>
+bool intersect_each(const Point *t, const Point &s1, const Point &s2) {
+    bool ret = overlap_module_segment<N>(t, s1, s2);
+    check_kernel(ret, fan_intersect<N>(t, create_segment(s1, s2)));
+    return ret;
+}
+
+bool intersect_each(const Point &p1, const Point &p2, const Point &q1, const Point &q2) {
+    bool ret = overlap_segments(p1, p2, q1, q2);
+    check_kernel(ret, CGAL::do_intersect(create_segment(p1, p2), create_segment(q1, q2)));
+    return ret;
+}
+
+// n holds the side normals of the module centered at c; the side whose normal is within half a side angle of p,
+// with 10 degrees of slack for float noise
+template <int N>
+int calc_direction(const Point &c, const Vector *n, const Point &p) {
+    static const double cos_half = cos(to_rad(180.0 / N)),
+                        cos_slack = cos(to_rad(180.0 / N + 10));
+    Vector v = p - c;
+    for (int i = 0; i < N; i++)
+        if (cos_half * v.Length() <= v.x * n[i].x + v.y * n[i].y)
+            return i;
+    for (int i = 0; i < N; i++)
+        if (cos_slack * v.Length() <= v.x * n[i].x + v.y * n[i].y)
+            return i;
+    exit(-1);
+}
+
+double calc_weight(const double dis, const double min_dis) {  //(dis / min_dis)^-12
+    double w = min_dis / dis,
+           w2 = w * w,
+           w4 = w2 * w2;
+    return w4 * w4 * w4;
+}
+
+// exact contact distances of modules given by their unit side normals n: with an odd side count the corners
+// sit at -n[k], with an even one halfway between neighbouring normals; the support value of a module
+// in direction m is the largest corner . m
+template <int N>
+double support(const Vector *n, const double mx, const double my) {
+    const double apothem = shape_of<N>().apothem;
+    double h = -INFINITY;
+    for (int k = 0; k < N; k++)
+        if (N % 2)
+            h = max(h, -(n[k].x * mx + n[k].y * my));
+        else {
+            const Vector &n2 = n[(k + 1) % N];
+            h = max(h, ((n[k].x + n2.x) * mx + (n[k].y + n2.y) * my) / (2 * apothem));
+        }
+    return h;
+}
+
+// centre distance along v at which module b just touches module a, both scaled by sa / sb: the ray from a's centre
+// leaves the Minkowski difference a - b, bounded by the sides of a and of -b with support h_a(m) + h_b(-m)
+template <int N>
+double touch_distance(const Vector *na, const double sa, const Vector *nb, const double sb, const Vector &v) {
+    const double len = v.Length(),
+                 ux = v.x / len,
+                 uy = v.y / len;
+    double d = INFINITY;
+    for (int side = 0; side < 2 * N; side++) {
+        const Vector &m = side < N ? na[side] : -nb[side - N];
+        const double mu = m.x * ux + m.y * uy;
+        if (ZERO < mu)
+            d = min(d, (sa * support<N>(na, m.x, m.y) + sb * support<N>(nb, -m.x, -m.y)) / mu);
+    }
+    return d;
+}
+
+// distance the module centred at c, scaled by sc, has to move along the unit vector w to clear the segment uv:
+// c leaves uv - module, bounded by both sides of the segment and the reversed module sides
+template <int N>
+double clear_distance(const Point &c, const Vector *n, const double sc, const Point &u, const Point &v, const Vector &w) {
+    const Vector s = v - u;
+    Vector side[2 + N] = {Vector(-s.y, s.x), Vector(s.y, -s.x)};
+    for (int k = 0; k < N; k++)
+        side[2 + k] = -n[k];
+    double d = INFINITY;
+    for (int k = 0; k < 2 + N; k++) {
+        const Vector &m = side[k];
+        const double mw = m.x * w.x + m.y * w.y;
+        if (ZERO < mw)
+            d = min(d, (max(m.x * u.x + m.y * u.y, m.x * v.x + m.y * v.y) + sc * support<N>(n, -m.x, -m.y) - (m.x * c.x + m.y * c.y)) / mw);
+    }
+    return max(0.0, d);
+}
+
+// neighbour forces of many (module, side) pairs, one pair per lane:
+// v is the offset to the neighbour, t the side tangent, m the neighbour side middle relative to the module
+// and md the centre distance at which the two touch
+struct ForceBatch {
+    int size;
+    vector<double> vx, vy, tx, ty, mx, my, md;
+    vector<double> fx, fy, weight;
+
+    void resize(const int n) {
+        size = n;
+        vector<double> *all[] = {&vx, &vy, &tx, &ty, &mx, &my, &md, &fx, &fy, &weight};
+        for (int i = 0; i < sizeof(all) / sizeof(all[0]); i++)
+            all[i]->resize(n + 4);  // room for a full last vector
+    }
+};
+
+void calc_forces_scalar(ForceBatch &b, const int from, const int to) {
+    for (int i = from; i < to; i++) {
+        double len = sqrt(b.vx[i] * b.vx[i] + b.vy[i] * b.vy[i]),
+               min_distance = b.md[i],
+               q = min_distance / len,
+               kr = 1 - q * q,
+               kt = 0.5 * (b.mx[i] * b.tx[i] + b.my[i] * b.ty[i]),
+               weight = calc_weight(min_distance, 2) + calc_weight(len, 2),
+               kr_len = kr / len;
+        // same operation order as the vector lanes, so a pair gets the same force wherever it lands
+        b.fx[i] = weight * (kr_len * b.vx[i] + kt * b.tx[i]);
+        b.fy[i] = weight * (kr_len * b.vy[i] + kt * b.ty[i]);
+        b.weight[i] = weight;
+    }
+}
+
+#if defined(__AVX2__)
+#define FORCE_LANES 4
+#define vec __m256d
+#define vec_load _mm256_loadu_pd
+#define vec_store _mm256_storeu_pd
+#define vec_set1 _mm256_set1_pd
+#define vec_add _mm256_add_pd
+#define vec_sub _mm256_sub_pd
+#define vec_mul _mm256_mul_pd
+#define vec_div _mm256_div_pd
+#define vec_max _mm256_max_pd
+#define vec_sqrt _mm256_sqrt_pd
+#elif defined(__SSE2__)
+#define FORCE_LANES 2
+#define vec __m128d
+#define vec_load _mm_loadu_pd
+#define vec_store _mm_storeu_pd
+#define vec_set1 _mm_set1_pd
+#define vec_add _mm_add_pd
+#define vec_sub _mm_sub_pd
+#define vec_mul _mm_mul_pd
+#define vec_div _mm_div_pd
+#define vec_max _mm_max_pd
+#define vec_sqrt _mm_sqrt_pd
+#endif
+
+void calc_forces(ForceBatch &b) {
+    int i = 0;
+#ifdef FORCE_LANES
+    const vec one = vec_set1(1), half = vec_set1(0.5), two = vec_set1(2);
+    for (; i + FORCE_LANES <= b.size; i += FORCE_LANES) {
+        vec vx = vec_load(&b.vx[i]), vy = vec_load(&b.vy[i]),
+            tx = vec_load(&b.tx[i]), ty = vec_load(&b.ty[i]),
+            len = vec_sqrt(vec_add(vec_mul(vx, vx), vec_mul(vy, vy))),
+            min_distance = vec_load(&b.md[i]),
+            q = vec_div(min_distance, len),
+            kr = vec_sub(one, vec_mul(q, q)),
+            kt = vec_mul(half, vec_add(vec_mul(vec_load(&b.mx[i]), tx), vec_mul(vec_load(&b.my[i]), ty))),
+            w1 = vec_div(two, min_distance),
+            w2 = vec_div(two, len);
+        w1 = vec_mul(w1, w1);
+        w1 = vec_mul(w1, w1);
+        w1 = vec_mul(vec_mul(w1, w1), w1);
+        w2 = vec_mul(w2, w2);
+        w2 = vec_mul(w2, w2);
+        w2 = vec_mul(vec_mul(w2, w2), w2);
+        vec weight = vec_add(w1, w2),
+            kr_len = vec_div(kr, len);
+        vec_store(&b.fx[i], vec_mul(weight, vec_add(vec_mul(kr_len, vx), vec_mul(kt, tx))));
+        vec_store(&b.fy[i], vec_mul(weight, vec_add(vec_mul(kr_len, vy), vec_mul(kt, ty))));
+        vec_store(&b.weight[i], weight);
+    }
+#endif
+    calc_forces_scalar(b, i, b.size);
+}
+
+#ifdef FORCE_LANES
+#undef vec
+#undef vec_load
+#undef vec_store
+#undef vec_set1
+#undef vec_add
+#undef vec_sub
+#undef vec_mul
+#undef vec_div
+#undef vec_max
+#undef vec_sqrt
+#endif
+
+// module geometry of one frame, computed once at the start of calc_next_step and read by every pass, modules added
+// within the frame are appended:
+// side k of module i has outward normal normal[N * i + k] (at angle[i] + k * side_angle) and midpoint
+// middle[N * i + k], vertex[N * i ...] are the corners in the order of Shape, all scaled by scale[i]
+template <int N>
+struct Geometry {
+    Points position;
+    vector<double> angle, scale;
+    Vectors normal;
+    Points vertex, middle;
+
+    void build(const Points &positions, const vector<double> &angles, const vector<double> &scales) {
+        const int n = positions.size();
+        position.resize(n);
+        angle.resize(n);
+        scale.assign(scales.begin(), scales.end());
+        normal.resize(N * n);
+        vertex.resize(N * n);
+        middle.resize(N * n);
+#pragma omp parallel for schedule(static)
+        for (int i = 0; i < n; i++)
+            set(i, positions[i], angles[i]);
+    }
+
+    // one module more, after those built over
+    void add(const Point &p, const double a, const double sc) {
+        const int n = position.size();
+        position.resize(n + 1);
+        angle.resize(n + 1);
+        scale.push_back(sc);
+        normal.resize(N * (n + 1));
+        vertex.resize(N * (n + 1));
+        middle.resize(N * (n + 1));
+        set(n, p, a);
+    }
+
+    void set(const int i, const Point &c, const double a) {
+        // headings relative to the module angle, as (cos, sin) of the offset
+        const Shape<N> &shape = shape_of<N>();
+        const double (&normal_turn)[N][2] = shape.normal_turn,
+                     (&vertex_turn)[N][2] = shape.corner_turn;
+        position[i] = c;
+        angle[i] = to_deg(a);
+        const double sa = sin(a),
+                     ca = cos(a),
+                     sc = scale[i];
+        for (int k = 0; k < N; k++) {
+            // (sin, cos) of angle + offset
+            Vector nk(sa * normal_turn[k][0] + ca * normal_turn[k][1], ca * normal_turn[k][0] - sa * normal_turn[k][1]),
+                   vk(sa * vertex_turn[k][0] + ca * vertex_turn[k][1], ca * vertex_turn[k][0] - sa * vertex_turn[k][1]);
+            normal[N * i + k] = nk;
+            vertex[N * i + k] = c + sc * vk;
+            middle[N * i + k] = c + shape.apothem * sc * nk;
+        }
+    }
+};
+
+// uniform cell list over module centers, rebuilt every frame
+// normalized modules have circumradius 1, so overlapping modules are at most 2 apart
+#define MODULE_RADIUS 1.0
+// the neighbour search looks this many grid cells (of 2 * MODULE_RADIUS) around a module; a side facing the
+// border has no neighbour at all and would otherwise widen the search over the whole grid every frame
+#define NEIGHBOUR_RINGS 3
+// local relaxation: modules this close to a deleted one move, the rest stay frozen
+// until E has not improved for LOCAL_PATIENCE frames or LOCAL_FRAMES have passed
+#define LOCAL_RADIUS (4 * MODULE_RADIUS)
+#define LOCAL_PATIENCE 120
+#define LOCAL_FRAMES 1800
+// batch deletion removes at most this share of the modules per plateau
+#define BATCH_FRACTION 0.1
+// random poses tried per palette size when the converged modules get company
+#define INSERT_TRIES 1000
+// a module falls asleep after SLEEP_FRAMES frames with speed below SLEEP_SPEED and spin below SLEEP_SPIN (rad/s)
+// and wakes when it is evaluated next to a moving module and is pushed harder than that
+#define SLEEP_SPEED 3e-4
+#define SLEEP_SPIN 3e-4
+#define SLEEP_FRAMES 60
+// rebuilt every frame into the same arrays, which only allocate when the module count reaches a new high
+struct Grid {
+    double size;
+    Point lb;
+    int w, h;
+    vector<int> start, items, cell,
+                added, next;
+
+    void build(const Points &points, const double cell_size) {
+        size = cell_size;
+        w = h = 1;
+        added.clear();
+        if (points.empty()) {
+            lb = Point(0, 0);
+            start.assign(2, 0);
+            items.clear();
+            return;
+        }
+        lb = points[0];
+        Point rt = lb;
+        for (int i = 1; i < points.size(); i++) {
+            const Point &p = points[i];
+            lb.x = min(lb.x, p.x);
+            lb.y = min(lb.y, p.y);
+            rt.x = max(rt.x, p.x);
+            rt.y = max(rt.y, p.y);
+        }
+        w = int((rt.x - lb.x) / size) + 1;
+        h = int((rt.y - lb.y) / size) + 1;
+        cell.resize(points.size());
+        start.assign(w * h + 1, 0);
+        for (int i = 0; i < points.size(); i++) {
+            int x, y;
+            locate(points[i], x, y);
+            start[cell[i] = y * w + x]++;
+        }
+        for (int c = 0; c < w * h; c++)
+            start[c + 1] += start[c];
+        items.resize(points.size());
+        for (int i = points.size() - 1; 0 <= i; i--)
+            items[--start[cell[i]]] = i;
+    }
+
+    // module i, after those built over, goes to the front of a list per cell; outside the grid it counts to the
+    // nearest cell like locate, so modules less than a cell apart still end up in neighbouring cells
+    void add(const Point &p, const int i) {
+        if (added.empty())
+            added.assign(w * h, -1);
+        int x, y;
+        locate(p, x, y);
+        next.resize(i + 1);
+        next[i] = added[y * w + x];
+        added[y * w + x] = i;
+    }
+
+    void locate(const Point &p, int &x, int &y) const {
+        x = min(w - 1, max(0, int((p.x - lb.x) / size)));
+        y = min(h - 1, max(0, int((p.y - lb.y) / size)));
+    }
+
+    template <class F>
+    void for_cell(const int x, const int y, const F &f) const {
+        if (0 <= x && x < w && 0 <= y && y < h) {
+            const int c = y * w + x;
+            for (int m = start[c]; m < start[c + 1]; m++)
+                f(items[m]);
+            if (!added.empty())
+                for (int i = added[c]; i != -1; i = next[i])
+                    f(i);
+        }
+    }
+
+    // every module in the cells at chebyshev distance r around (x, y), in index order per cell, those added since the build last
+    template <class F>
+    void for_ring(const int x, const int y, const int r, F f) const {
+        for (int cy = y - r; cy <= y + r; cy++)
+            if (abs(cy - y) == r)
+                for (int cx = x - r; cx <= x + r; cx++)
+                    for_cell(cx, cy, f);
+            else {
+                for_cell(x - r, cy, f);
+                for_cell(x + r, cy, f);
+            }
+    }
+};
+
+// cell lists over the border edges, built once per polygon, so edge queries only touch edges nearby
+// cells hold every edge crossing them, rows hold every edge whose y range meets them
+struct EdgeGrid {
+    double size;
+    Point lb;
+    int w, h;
+    Points polygon;
+    vector<int> start, items,
+                row_start, row_items;
+
+    EdgeGrid(const Points &polygon, const double cell_size) : size(cell_size), polygon(polygon) {
+        lb = polygon[0];
+        Point rt = lb;
+        for (int i = 1; i < polygon.size(); i++) {
+            lb.x = min(lb.x, polygon[i].x);
+            lb.y = min(lb.y, polygon[i].y);
+            rt.x = max(rt.x, polygon[i].x);
+            rt.y = max(rt.y, polygon[i].y);
+        }
+        w = int((rt.x - lb.x) / size) + 1;
+        h = int((rt.y - lb.y) / size) + 1;
+
+        // (cell, edge) and (row, edge) pairs, bucketed by a counting sort
+        vector<pair<int, int> > cell_edges, row_edges;
+        for (int j = 0; j < polygon.size(); j++) {
+            const Point &u = polygon[j],
+                        &v = polygon[(j + 1) % polygon.size()];
+            int x0, y0, x1, y1;
+            locate(Point(min(u.x, v.x), min(u.y, v.y)), x0, y0);
+            locate(Point(max(u.x, v.x), max(u.y, v.y)), x1, y1);
+            for (int y = y0; y <= y1; y++) {
+                row_edges.push_back(make_pair(y, j));
+                for (int x = x0; x <= x1; x++)
+                    if (crosses(u, v, x, y))
+                        cell_edges.push_back(make_pair(y * w + x, j));
+            }
+        }
+        bucket(cell_edges, w * h, start, items);
+        bucket(row_edges, h, row_start, row_items);
+    }
+
+    void locate(const Point &p, int &x, int &y) const {
+        x = min(w - 1, max(0, int((p.x - lb.x) / size)));
+        y = min(h - 1, max(0, int((p.y - lb.y) / size)));
+    }
+
+    // indices of the edges that may touch the box [plb, prt], ascending and without repeats
+    void query(const Point &plb, const Point &prt, vector<int> &edges) const {
+        int x0, y0, x1, y1;
+        locate(plb, x0, y0);
+        locate(prt, x1, y1);
+        edges.clear();
+        for (int y = y0; y <= y1; y++)
+            for (int x = x0; x <= x1; x++)
+                for (int c = y * w + x, m = start[c]; m < start[c + 1]; m++)
+                    edges.push_back(items[m]);
+        sort(edges.begin(), edges.end());
+        edges.erase(unique(edges.begin(), edges.end()), edges.end());
+    }
+
+    // even-odd test with a ray towards +x, over the edges of p's row only
+    bool contains(const Point &p) const {
+        if (p.y < lb.y || lb.y + h * size < p.y)
+            return false;
+        int x, y;
+        locate(p, x, y);
+        bool inside = false;
+        for (int m = row_start[y]; m < row_start[y + 1]; m++) {
+            const Point &u = polygon[row_items[m]],
+                        &v = polygon[(row_items[m] + 1) % polygon.size()];
+            if ((p.y < u.y) != (p.y < v.y) && p.x < u.x + (p.y - u.y) * (v.x - u.x) / (v.y - u.y))
+                inside = !inside;
+        }
+        return inside;
+    }
+
+private:
+    // whether segment uv may meet cell (x, y): the cell corners are not all clearly on one side of its line
+    bool crosses(const Point &u, const Point &v, const int x, const int y) const {
+        const double x0 = lb.x + x * size, y0 = lb.y + y * size,
+                     eps = 1e-6 * size * (v - u).Length();
+        int side = 0;
+        for (int c = 0; c < 4; c++) {
+            double cross = (v.x - u.x) * (y0 + (c >> 1) * size - u.y) - (v.y - u.y) * (x0 + (c & 1) * size - u.x);
+            side |= cross < -eps ? 1 : eps < cross ? 2 : 3;
+        }
+        return side == 3;
+    }
+
+    static void bucket(const vector<pair<int, int> > &pairs, const int buckets, vector<int> &start, vector<int> &items) {
+        start.assign(buckets + 1, 0);
+        for (int m = 0; m < pairs.size(); m++)
+            start[pairs[m].first + 1]++;
+        for (int b = 0; b < buckets; b++)
+            start[b + 1] += start[b];
+        items.resize(pairs.size());
+        vector<int> fill(start.begin(), start.end() - 1);
+        for (int m = 0; m < pairs.size(); m++)
+            items[fill[pairs[m].first]++] = pairs[m].second;
+    }
+};
+
+// uniform points over a polygon: a triangle is picked with probability proportional to its area
+// through an alias table (one draw, one comparison), then a point inside it
+struct AreaSampler {
+    Points corner;
+    vector<double> chance;
+    vector<int> alias;
+
+    AreaSampler(const Points &polygon) {
+        vector<int> triangles = triangulate_polygon(polygon);
+        const int n = triangles.size() / 3;
+        vector<double> area(n);
+        double sum = 0;
+        for (int t = 0; t < n; t++) {
+            for (int k = 0; k < 3; k++)
+                corner.push_back(polygon[triangles[3 * t + k]]);
+            const Point &a = corner[3 * t], &b = corner[3 * t + 1], &c = corner[3 * t + 2];
+            sum += area[t] = abs(double(b.x - a.x) * (c.y - a.y) - double(b.y - a.y) * (c.x - a.x)) / 2;
+        }
+
+        // Vose's alias method
+        chance.assign(n, 1);
+        alias.resize(n);
+        vector<int> small, large;
+        for (int t = 0; t < n; t++) {
+            alias[t] = t;
+            area[t] *= n / sum;
+            (area[t] < 1 ? small : large).push_back(t);
+        }
+        while (!small.empty() && !large.empty()) {
+            const int l = small.back(), g = large.back();
+            small.pop_back();
+            chance[l] = area[l];
+            alias[l] = g;
+            area[g] -= 1 - area[l];
+            if (area[g] < 1) {
+                large.pop_back();
+                small.push_back(g);
+            }
+        }
+    }
+
+    Point sample(mt19937 &rng) const {
+        const int n = chance.size();
+        double u = rand_unit(rng) * n;
+        int t = min(n - 1, int(u));
+        if (chance[t] <= u - t)
+            t = alias[t];
+        double r1 = rand_unit(rng), r2 = rand_unit(rng);
+        if (1 < r1 + r2) {
+            r1 = 1 - r1;
+            r2 = 1 - r2;
+        }
+        const Point &a = corner[3 * t], &b = corner[3 * t + 1], &c = corner[3 * t + 2];
+        return Point(a.x + r1 * (b.x - a.x) + r2 * (c.x - a.x), a.y + r1 * (b.y - a.y) + r2 * (c.y - a.y));
+    }
+};
+
+// modules cut from a triangular tiling of the border: the tiling with side sqrt(3) is turned by 60 / turns
+// degree steps and shifted on an offsets x offsets grid over one lattice cell, the placement keeping
+// the most whole triangles inside the border wins; returns the number of modules
+int lattice_layout(const Points &polygon, const EdgeGrid &edges, Points &positions, vector<double> &angles,
+                   const int turns = 20, const int offsets = 12) {
+    Point plb = polygon[0],
+          prt = polygon[0];
+    for (int i = 1; i < polygon.size(); i++) {
+        plb.x = min(plb.x, polygon[i].x);
+        plb.y = min(plb.y, polygon[i].y);
+        prt.x = max(prt.x, polygon[i].x);
+        prt.y = max(prt.y, polygon[i].y);
+    }
+    const double side = sqrt(3);
+    vector<char> inside;
+    Points lattice;
+    vector<int> near_edges;
+    positions.clear();
+    angles.clear();
+    for (int r = 0; r < turns; r++) {
+        // lattice point (i, j) = o + i * e1 + j * e2
+        const double turn = to_rad(60.0 * r / turns);
+        const Vector e1(side * cos(turn), side * sin(turn)),
+                     e2(side * cos(turn + pi / 3), side * sin(turn + pi / 3));
+        for (int ou = 0; ou < offsets; ou++)
+            for (int ov = 0; ov < offsets; ov++) {
+                const Point o(plb.x + (ou * e1.x + ov * e2.x) / offsets, plb.y + (ou * e1.y + ov * e2.y) / offsets);
+
+                // (i, j) range covering the bounding box
+                const double det = e1.x * e2.y - e1.y * e2.x;
+                int i0 = INT_MAX, i1 = INT_MIN, j0 = INT_MAX, j1 = INT_MIN;
+                for (int c = 0; c < 4; c++) {
+                    const double dx = (c & 1 ? prt.x : plb.x) - o.x,
+                                 dy = (c & 2 ? prt.y : plb.y) - o.y,
+                                 i = (dx * e2.y - dy * e2.x) / det,
+                                 j = (dy * e1.x - dx * e1.y) / det;
+                    i0 = min(i0, int(floor(i)) - 1);
+                    i1 = max(i1, int(ceil(i)) + 1);
+                    j0 = min(j0, int(floor(j)) - 1);
+                    j1 = max(j1, int(ceil(j)) + 1);
+                }
+                const int w = i1 - i0 + 1, h = j1 - j0 + 1;
+                lattice.resize(w * h);
+                inside.resize(w * h);
+                for (int j = 0; j < h; j++)
+                    for (int i = 0; i < w; i++) {
+                        lattice[j * w + i] = Point(o.x + (i0 + i) * e1.x + (j0 + j) * e2.x, o.y + (i0 + i) * e1.y + (j0 + j) * e2.y);
+                        inside[j * w + i] = edges.contains(lattice[j * w + i]);
+                    }
+
+                // up triangle (i, j), (i + 1, j), (i, j + 1) has angle 60, down triangle (i + 1, j), (i + 1, j + 1), (i, j + 1) angle 0
+                Points layout;
+                vector<double> layout_angles;
+                for (int j = 0; j + 1 < h; j++)
+                    for (int i = 0; i + 1 < w; i++)
+                        for (int d = 0; d < 2; d++) {
+                            const int a = d ? j * w + i + 1 : j * w + i,
+                                      b = d ? (j + 1) * w + i + 1 : j * w + i + 1,
+                                      c = (j + 1) * w + i;
+                            if (!inside[a] || !inside[b] || !inside[c])
+                                continue;
+                            const Point t[3] = {lattice[a], lattice[b], lattice[c]};
+                            edges.query(Point(min(t[0].x, min(t[1].x, t[2].x)), min(t[0].y, min(t[1].y, t[2].y))),
+                                        Point(max(t[0].x, max(t[1].x, t[2].x)), max(t[0].y, max(t[1].y, t[2].y))), near_edges);
+                            bool cut = false;
+                            for (int m = 0; m < near_edges.size() && !cut; m++)
+                                cut = intersect_each<3>(t, polygon[near_edges[m]], polygon[(near_edges[m] + 1) % polygon.size()]);
+                            if (cut)
+                                continue;
+                            layout.push_back(Point((t[0].x + t[1].x + t[2].x) / 3, (t[0].y + t[1].y + t[2].y) / 3));
+                            // headings run clockwise from +y, so turning the tiling counterclockwise lowers them
+                            layout_angles.push_back(float32(to_rad((d ? 0 : 60) - 60.0 * r / turns)));
+                        }
+                if (positions.size() < layout.size()) {
+                    positions.swap(layout);
+                    angles.swap(layout_angles);
+                }
+            }
+    }
+    return positions.size();
+}
+
+// everything one placement run carries from frame to frame, so runs can go side by side
+struct State {
+    double K = 1, E = INT_MAX, pre_E = 0, min_E = INT_MAX, min_K = 1;
+    int min_t = 0;
+    int frame = 0;
+    int pause_time = 0;
+    pair<int, int> pre_del = pair<int, int>(-1, 0);
+    vector<Point> min_p;  // layout of min_E (and min_K) with the current module count
+    vector<double> min_a;
+    time_t stime = -1;
+    mt19937 rng;
+};
+
+#ifndef ITPLA_NO_BOX2D
+void save_status(const vector<b2Body *> &points, Vectors &v, vector<double> &a) {
+    v.clear();
+    a.clear();
+    for (int i = 0; i < points.size(); i++) {
+        b2Body *p = points[i];
+        v.push_back(p->GetPosition());
+        a.push_back(p->GetAngle());
+    }
+}
+
+void load_status(const vector<b2Body *> &points, const Vectors &v, const vector<double> &a) {
+    for (int i = 0; i < points.size(); i++) {
+        b2Body *p = points[i];
+        p->SetTransform(v[i] - p->GetPosition(), a[i] - p->GetAngle());
+    }
+}
+#endif
+
+// one sample of the annealing state, taken every few frames
+struct TraceRow {
+    time_t stime;
+    int frame, modules;
+    double E, K, min_E;
+    int pause_time;
+    int candidate, candidate_frames;  // module that would be deleted next and for how many frames in a row
+    // what the frame did: "step", or how the plateau ending in it was left: "delete", "insert", "reject" or
+    // "converge"; a plateau frame does not advance the frame count, so the next row has the same frame
+    const char *event;
+};
+
+// rows a run collects before it offers them to the writer
+#define TRACE_CHUNK 256
+
+// streams trace rows of any number of runs into one CSV file from a background thread;
+// a run only ever try_locks, and keeps its rows for the next offer when the writer is busy
+class TraceWriter {
+public:
+    TraceWriter(const string &filename) : fout(fopen(filename.c_str(), "w")), done(false) {
+        if (fout == NULL)
+            return;
+        fprintf(fout, "stime,frame,modules,E,K,min_E,pause_time,candidate,candidate_frames,event\n");
+        writer = thread(&TraceWriter::run, this);
+    }
+
+    // writes what is still queued; every run must have handed over its rest before
+    ~TraceWriter() {
+        if (fout == NULL)
+            return;
+        {
+            lock_guard<mutex> guard(lock);
+            done = true;
+        }
+        wake.notify_one();
+        writer.join();
+        fclose(fout);
+    }
+
+    bool is_open() const { return fout != NULL; }
+
+    // moves rows to the queue unless another thread holds it and wait is false
+    bool hand_over(vector<TraceRow> &rows, const bool wait) {
+        unique_lock<mutex> guard(lock, defer_lock);
+        if (wait)
+            guard.lock();
+        else if (!guard.try_lock())
+            return false;
+        queued.insert(queued.end(), rows.begin(), rows.end());
+        guard.unlock();
+        rows.clear();
+        wake.notify_one();
+        return true;
+    }
+
+private:
+    TraceWriter(const TraceWriter &) = delete;
+    TraceWriter &operator=(const TraceWriter &) = delete;
+
+    void run() {
+        vector<TraceRow> rows;
+        for (bool last = false; !last;) {
+            {
+                unique_lock<mutex> guard(lock);
+                wake.wait(guard, [this]() { return done || !queued.empty(); });
+                rows.swap(queued);
+                last = done;
+            }
+            for (int i = 0; i < rows.size(); i++) {
+                const TraceRow &r = rows[i];
+                fprintf(fout, "%lld,%d,%d,%.9lf,%.9lf,%.9lf,%d,%d,%d,%s\n", (long long)r.stime, r.frame, r.modules,
+                        r.E, r.K, r.min_E, r.pause_time, r.candidate, r.candidate_frames, r.event);
+            }
+            rows.clear();
+            fflush(fout);
+        }
+    }
+
+    FILE *fout;
+    vector<TraceRow> queued;
+    mutex lock;
+    condition_variable wake;
+    bool done;
+    thread writer;
+};
+
+struct Result {
+    Points positions;
+    vector<double> angles, scales;
+    double K;
+    int frame;
+    time_t stime;
+    Profile profile;
+};
+
+// switches of one placement job, fixed when the Placer is built, so jobs with different options can run side by side
+struct Options {
+    bool lattice_start = false;  // start from the best clipped triangular tiling instead of random poses
+    bool batch_delete = false;   // delete several modules per plateau while K is far from 1
+    bool local_relax = false;    // after a deletion only move the modules around the hole until it settles
+    bool sleep_modules = false;  // stop evaluating modules that have been at rest for a while
+    bool exact_distance = false; // touching distances from support functions instead of the side-angle estimate
+    // smaller module sizes relative to edge_length; every run starts with full size modules, a module deleted for
+    // overlap once K >= 0.7 leaves its hole to smaller ones, and once the modules have converged the free space left
+    // is filled with modules of these sizes, one per plateau
+    vector<double> size_palette;
+    // one per size_palette entry, all 0 if empty: the sizes are offered to a hole or the free space in order of
+    // priority, the larger size first among equal priorities
+    vector<double> size_priority;
+    // a module put in from the palette stays only if the plateau after it ends with K at least this
+    double keep_K = 0.85;
+};
+
+// options with the palette in the order its sizes are offered
+Options order_palette(Options options) {
+    vector<pair<double, double> > entries;
+    for (int p = 0; p < options.size_palette.size(); p++)
+        entries.push_back(make_pair(p < options.size_priority.size() ? options.size_priority[p] : 0, options.size_palette[p]));
+    sort(entries.rbegin(), entries.rend());
+    options.size_palette.clear();
+    options.size_priority.clear();
+    for (int p = 0; p < entries.size(); p++) {
+        options.size_priority.push_back(entries[p].first);
+        options.size_palette.push_back(entries[p].second);
+    }
+    return options;
+}
+
+// one placement job: the border, the module poses and the annealing state
+// the poses live in flat arrays and are advanced by an explicit Euler step with Box2D's per-step clamps,
+// built with Box2D (the default) they are mirrored into a b2World instead and stepped by it
+template <int N>
+class Placer {
+public:
+    Placer(const Points &polygon, double edge_length, time_t stime = -1, const Options &options = Options());
+    ~Placer();
+
+    bool step();
+    void run_until_converged(const string &checkpoint = "", int every = 10000);
+    Result result() const;
+    Result best() const;
+    void reset(time_t stime = -1);
+    bool save(const string &filename) const;
+    bool load(const string &filename);
+
+    const Points &border() const { return normalized_polygon; }
+    const Points &positions() const { return points; }
+    const vector<double> &angles() const { return angles_; }
+    const vector<double> &scales() const { return scale_; }
+    const Vectors &velocities() const { return velocity; }
+    const State &state() const { return s; }
+    const Profile &profile() const { return prof; }
+    const Options &options() const { return opt; }
+    // samples the state every `every` frames into trace, which must outlive the placer; NULL stops tracing
+    void trace_to(TraceWriter *trace, int every = 100);
+
+private:
+    Placer(const Placer &) = delete;
+    Placer &operator=(const Placer &) = delete;
+
+    void place();
+    bool calc_next_step();
+    void integrate();
+    void remove(int i);
+    void add(const Point &p, double angle, double scale);
+    void corners(const Point &c, double angle, double scale, Point *v) const;
+    void index_layout();
+    void add_indexed(const Point &p, double angle, double scale);
+    bool fits(const Point &c, double angle, double scale, vector<int> &near_edges) const;
+    bool insert(Points &holes);
+    int refill(const Point &hole, double scale);
+    void restore_trial();
+    void new_plateau();
+    void wake_around(const Points &holes);
+#ifndef ITPLA_NO_BOX2D
+    void create_world();
+    b2Body *create_body(const Point &p, double angle);
+#endif
+
+    const Shape<N> &shape;
+    Geometry<N> g;
+    ForceBatch batch;
+    // scratch of calc_next_step, kept between frames: nearest module per side, overlapped modules and border edges
+    Grid grid;
+    vector<vector<int> > nearest_point, overlap_module, overlap_edge;
+
+    const Points polygon, normalized_polygon;
+    const double edge_length;
+    const Options opt;
+    const EdgeGrid edges;
+    const AreaSampler sampler;
+    // integrate writes the new poses to the back arrays and swaps, so the poses of the last frame stay around
+    // for one more step; the minimum energy layout is copied from there only when an improving streak ends
+    Points points, back_points;
+    vector<double> angles_, back_angles;
+    vector<double> scale_;  // module size relative to edge_length, 1 unless shrunk to a size_palette entry
+    enum { none, in_front, in_back } pending;
+    Vectors velocity;
+    vector<double> spin;
+#ifndef ITPLA_NO_BOX2D
+    b2World *world;
+    vector<b2Body *> bodies;
+#endif
+    State s;
+    Profile prof;
+    TraceWriter *trace;
+    int trace_every;
+    vector<TraceRow> trace_rows;
+    // modules allowed to move after a local deletion, empty while every module does; the frozen ones
+    // out of reach of any active module keep their energy, k_min and rank from the last frame they were evaluated
+    vector<char> active;
+    vector<double> cached_energy, cached_k_min;
+    vector<pair<int, double> > cached_rank;
+    int local_frames;
+    vector<int> calm;  // frames each module has been at rest, asleep from SLEEP_FRAMES on
+    // the converged layout before the last insert while its module is on trial; palette sizes before insert_from are
+    // not tried any more
+    Points trial_p;
+    vector<double> trial_a, trial_s;
+    double trial_K;
+    int insert_from;
+    // modules refill put into the holes of the last deletion, the last ones; taken out again unless K reaches keep_K
+    int swapped;
+    bool moving(int i) const { return (active.empty() || active[i]) && calm[i] < SLEEP_FRAMES; }
+    bool converged;
+};
+
+template <int N>
+bool Placer<N>::calc_next_step() {
+    bool ret = true;
+    // the per-module lists follow the module count, clearing keeps what earlier frames allocated
+    nearest_point.resize(points.size());
+    overlap_module.resize(points.size());
+    overlap_edge.resize(points.size());
+    for (int i = 0; i < points.size(); i++) {
+        nearest_point[i].assign(N, -1);
+        overlap_module[i].clear();
+        overlap_edge[i].clear();
+    }
+    PROFILE_LAPS(prof);
+    PROFILE_COUNT(prof, frames, 1);
+    grid.build(points, 2 * MODULE_RADIUS);
+    g.build(points, angles_, scale_);
+    const Points &vertices = g.vertex;
+    cached_energy.resize(points.size());
+    cached_k_min.resize(points.size());
+    cached_rank.resize(points.size());
+    calm.resize(points.size(), 0);
+    // frozen or sleeping modules are only evaluated next to a moving one
+    vector<char> need(points.size(), 1);
+    if (!active.empty() || opt.sleep_modules)
+        for (int i = 0; i < points.size(); i++) {
+            need[i] = moving(i);
+            int x, y;
+            grid.locate(g.position[i], x, y);
+            for (int cy = y - 1; cy <= y + 1 && !need[i]; cy++)
+                for (int cx = x - 1; cx <= x + 1; cx++)
+                    grid.for_cell(cx, cy, [&](const int j) { need[i] |= moving(j); });
+        }
+    PROFILE_COUNT(prof, evaluated, count(need.begin(), need.end(), 1));
+    PROFILE_LAP(grid);
+    // every per-module loop below writes only to slot i, sums over modules are taken afterwards in index order,
+    // so the outcome does not depend on the number of threads
+#pragma omp parallel for schedule(dynamic, 16)
+    for (int i = 0; i < points.size(); i++) {
+        if (!need[i])
+            continue;
+        const Point &p1 = g.position[i];
+        int x, y;
+        grid.locate(p1, x, y);
+
+        // nearest module in each direction closer than NEIGHBOUR_RINGS cells: widen the ring until nothing outside
+        // it can be closer, ties go to the lower index as in a plain scan over j
+        float32 nearest_dist[N];
+        for (int r = 0, found = 0; found < N && r <= NEIGHBOUR_RINGS; r++) {
+            grid.for_ring(x, y, r, [&](const int j) {
+                if (i == j)
+                    return;
+                const Point &p2 = g.position[j];
+                int k = calc_direction<N>(p1, &g.normal[N * i], p2);
+                float32 dist = (p2 - p1).Length();
+                if (nearest_point[i][k] == -1 || dist < nearest_dist[k] || (dist == nearest_dist[k] && j < nearest_point[i][k])) {
+                    nearest_point[i][k] = j;
+                    nearest_dist[k] = dist;
+                }
+            });
+            // anything beyond ring r is farther than r cells (less some float slack)
+            found = 0;
+            for (int k = 0; k < N; k++)
+                found += nearest_point[i][k] != -1 && nearest_dist[k] < r * grid.size - 1e-3;
+        }
+        // a module found in the last ring may have a closer one just outside it
+        for (int k = 0; k < N; k++)
+            if (nearest_point[i][k] != -1 && NEIGHBOUR_RINGS * grid.size - 1e-3 <= nearest_dist[k])
+                nearest_point[i][k] = -1;
+    }
+    PROFILE_LAP(neighbour);
+
+#pragma omp parallel
+    {
+    vector<int> candidates;
+#pragma omp for schedule(dynamic, 16)
+    for (int i = 0; i < points.size(); i++) {
+        if (!need[i])
+            continue;
+        const Point &p1 = g.position[i];
+        int x, y;
+        grid.locate(p1, x, y);
+        candidates.clear();
+        for (int cy = y - 1; cy <= y + 1; cy++)
+            for (int cx = x - 1; cx <= x + 1; cx++)
+                grid.for_cell(cx, cy, [&](const int j) {
+                    if (i != j && (g.position[j] - p1).Length() <= 2 * MODULE_RADIUS + 1e-3)
+                        candidates.push_back(j);
+                });
+        sort(candidates.begin(), candidates.end());
+        for (int m = 0; m < candidates.size(); m++) {
+            const int &j = candidates[m];
+            if (intersect_each<N>(&vertices[N * i], &vertices[N * j]))
+                overlap_module[i].push_back(j);
+        }
+        PROFILE_COUNT(prof, pair_tests, candidates.size());
+        PROFILE_COUNT(prof, module_hits, overlap_module[i].size());
+    }
+    }
+    PROFILE_LAP(module_overlap);
+
+#pragma omp parallel
+    {
+    vector<int> near_edges;
+#pragma omp for schedule(dynamic, 16)
+    for (int i = 0; i < points.size(); i++) {
+        if (!need[i])
+            continue;
+        const Point *tri = &vertices[N * i];
+        Point lb = tri[0], rt = tri[0];
+        for (int k = 1; k < N; k++) {
+            lb.x = min(lb.x, tri[k].x);
+            lb.y = min(lb.y, tri[k].y);
+            rt.x = max(rt.x, tri[k].x);
+            rt.y = max(rt.y, tri[k].y);
+        }
+        edges.query(lb, rt, near_edges);
+        for (int m = 0; m < near_edges.size(); m++) {
+            const int &j = near_edges[m];
+            const Point &s1 = normalized_polygon[j],
+                        &s2 = normalized_polygon[(j + 1) % normalized_polygon.size()];
+            if (intersect_each<N>(tri, s1, s2))
+                overlap_edge[i].push_back(j);
+        }
+        PROFILE_COUNT(prof, edge_tests, near_edges.size());
+        PROFILE_COUNT(prof, edge_hits, overlap_edge[i].size());
+    }
+    }
+    PROFILE_LAP(edge_overlap);
+
+    Vectors force(points.size(), Point(0, 0));
+    vector<double> angle(points.size(), 0);
+    s.K = 1;
+    s.pre_E = s.E;
+    s.E = 0;
+    vector<pair<pair<int, double>, int> > del_rank(points.size());
+    vector<double> energy(points.size(), 0),
+                   k_min(points.size(), 1);
+
+    // neighbour forces of every (module, side) pair go through the batched kernel,
+    // the pairs of module i start at pair_start[i]
+    vector<int> pair_start(points.size() + 1, 0);
+    for (int i = 0; i < points.size(); i++) {
+        pair_start[i + 1] = pair_start[i];
+        for (int k = 0; k < N; k++)
+            pair_start[i + 1] += nearest_point[i][k] != -1;
+    }
+    const int pairs = pair_start[points.size()];
+    batch.resize(pairs);
+    vector<double> pair_ang_diff(pairs);
+    vector<char> pair_close(pairs);
+#pragma omp parallel for schedule(static)
+    for (int i = 0; i < points.size(); i++)
+        for (int k = 0, b = pair_start[i]; k < N; k++)
+            if (nearest_point[i][k] != -1) {
+                const double ak = g.angle[i] + k * shape.side_angle;
+                const int &j = nearest_point[i][k];
+                const Point &p1 = g.position[i],
+                            &p2 = g.position[j];
+
+                const Vector v = p2 - p1,
+                             &n = g.normal[N * i + k],
+                             t = Point(n.y, -n.x);
+
+                int l = calc_direction<N>(p2, &g.normal[N * j], p1);
+
+                const double al = g.angle[j] + l * shape.side_angle;
+                const Vector &n2 = g.normal[N * j + l];
+                const Point p2_line_middle = g.middle[N * j + l] - p1;
+                double ang_diff = angle_diff(ak, al + 180);
+
+                batch.vx[b] = v.x;
+                batch.vy[b] = v.y;
+                batch.tx[b] = t.x;
+                batch.ty[b] = t.y;
+                batch.mx[b] = p2_line_middle.x;
+                batch.my[b] = p2_line_middle.y;
+                if (opt.exact_distance)
+                    batch.md[b] = touch_distance<N>(&g.normal[N * i], scale_[i], &g.normal[N * j], scale_[j], v);
+                else {
+                    const double vx = v.x, vy = v.y,
+                                 len = sqrt(vx * vx + vy * vy),
+                                 v_n_length = vx * n.x + vy * n.y,
+                                 v_n2_length = - (vx * n2.x + vy * n2.y);
+                    // the estimate is for two full size modules, a mixed pair takes the mean size
+                    batch.md[b] = (shape.apothem + sin(to_rad(90 - 180.0 / N + abs(ang_diff)))) * len / max(v_n_length, v_n2_length)
+                                * (0.5 * (scale_[i] + scale_[j]));
+                }
+                pair_ang_diff[b] = ang_diff;
+                pair_close[b] = (g.middle[N * i + k] - g.middle[N * j + l]).Length() < 0.15;
+                b++;
+            }
+    calc_forces(batch);
+
+#pragma omp parallel for schedule(dynamic, 16)
+    for (int i = 0; i < points.size(); i++) {
+        if (!need[i]) {
+            energy[i] = cached_energy[i];
+            k_min[i] = cached_k_min[i];
+            del_rank[i] = make_pair(cached_rank[i], i);
+            continue;
+        }
+        del_rank[i] = make_pair(make_pair(0.0, 0), i);
+        const Point &p1 = g.position[i];
+        int b = pair_start[i];
+
+        // summed in double: a module right on an edge has a weight far beyond float range
+        double weight_sum = 0, fx = 0, fy = 0;
+
+        for (int k = 0; k < N; k++)
+            if (nearest_point[i][k] != -1) {
+                fx += batch.fx[b];
+                fy += batch.fy[b];
+                angle[i] += 0.5 * pair_ang_diff[b] * batch.weight[b];
+                weight_sum += batch.weight[b];
+                if (pair_close[b])
+                    del_rank[i].first.first += 10;
+                b++;
+            }
+
+        for (int k = 0; k < overlap_module[i].size(); k++) {
+            const int &j = overlap_module[i][k];
+            const Point &p2 = g.position[j];
+            const int m = calc_direction<N>(p1, &g.normal[N * i], p2);
+            const double ak = g.angle[i] + m * shape.side_angle;
+
+            const Vector v = p2 - p1,
+                         &n = g.normal[N * i + m];
+
+            int l = calc_direction<N>(p2, &g.normal[N * j], p1);
+
+            const double al = g.angle[j] + l * shape.side_angle;
+            const Vector &n2 = g.normal[N * j + l];
+            double ang_diff = angle_diff(ak, al + 180);
+
+            double v_n_length = v.x * n.x + v.y * n.y,
+                   v_n2_length = - (v.x * n2.x + v.y * n2.y),
+                   min_distance = opt.exact_distance ? touch_distance<N>(&g.normal[N * i], scale_[i], &g.normal[N * j], scale_[j], v)
+                                                     : (shape.apothem + sin(to_rad(90 - 180.0 / N + abs(ang_diff)))) / (max(v_n_length, v_n2_length) / v.Length())
+                                                       * (0.5 * (scale_[i] + scale_[j]));
+            assert(0 <= v_n_length);
+            if (!(v.Length() < min_distance))
+                PROFILE_COUNT(prof, module_misses, 1);
+            energy[i] += max(0.0, 1 / (v.Length() / min_distance) - 1);
+            k_min[i] = min(k_min[i], double(v.Length() / min_distance));
+            del_rank[i].first.second -= max(0.0, 1 - v.Length() / min_distance);
+        }
+
+        for (int j = 0; j < overlap_edge[i].size(); j++) {
+            const Point &u = normalized_polygon[overlap_edge[i][j]],
+                        &v = normalized_polygon[(overlap_edge[i][j] + 1) % normalized_polygon.size()];
+            double dis = distance_to_line(p1, u, v);
+            Vector n = Point(u.y - v.y, v.x - u.x);
+            n.Normalize();
+            n *= 4;
+            int k = -1;
+            double min_dist = INT_MAX;
+            for (int l = 0; l < N; l++) {
+                double dist = distance_to_line(g.middle[N * i + l], u, v);
+                if (dist < min_dist) {
+                    min_dist = dist;
+                    k = l;
+                }
+            }
+            assert(k != -1);
+            const double ak = g.angle[i] + k * shape.side_angle;
+            double ang_diff = angle_diff(ak, 180 - to_deg(atan2(v.y - u.y, v.x - u.x)));
+            double min_distance = sin(to_rad(90 - 180.0 / N + abs(ang_diff)));
+
+            if (opt.exact_distance)
+                min_distance = dis + clear_distance<N>(p1, &g.normal[N * i], scale_[i], u, v, 0.25f * n);
+            else {
+                const pair<Point, Point> box[3] = {make_pair(u, v), make_pair(u, u - n), make_pair(v, v - n)};
+                // side l of a module runs between these two of its vertices
+                const int (&side)[N][2] = shape.side_corner;
+
+                Point intersect_points[3 * N];
+                int intersect_size = 0;
+                for (int l = 0; l < N; l++) {
+                    const Point &t1 = vertices[N * i + side[l][0]],
+                                &t2 = vertices[N * i + side[l][1]];
+                    Vector vt = t2 - t1;
+                    int intersect_num = 0;
+                    bool iu = false, iv = false;
+                    for (int m = 0; m < 3; m++)
+                        if (intersect_each(t1, t2, box[m].first, box[m].second)) {
+                            Vector vm = box[m].second - box[m].first;
+                            double A1 = vt.y,
+                                   B1 = -vt.x,
+                                   C1 = -A1 * t1.x - B1 * t1.y,
+                                   A2 = vm.y,
+                                   B2 = -vm.x,
+                                   C2 = -A2 * box[m].first.x - B2 * box[m].first.y,
+                                   ix = (B1 * C2 - C1 * B2) / (A1 * B2 - A2 * B1),
+                                   iy = (C1 * A2 - A1 * C2) / (A1 * B2 - A2 * B1);
+                            if ((u - Point(ix, iy)).Length() < ZERO)
+                                iu = true;
+                            else if ((v - Point(ix, iy)).Length() < ZERO)
+                                iv = true;
+                            else {
+                                intersect_num++;
+                                intersect_points[intersect_size++] = Point(ix, iy);
+                            }
+                        }
+                    intersect_num += iu + iv;
+                    if (intersect_num == 1) {
+                        if ((v - u).x * (t1 - v).y - (v - u).y * (t1 - v).x < 0)
+                            intersect_points[intersect_size++] = t1;
+                        else
+                            intersect_points[intersect_size++] = t2;
+                    }
+                }
+                double max_dis = 0;
+                for (int l = 0; l < intersect_size; l++)
+                    max_dis = max(max_dis, distance_to_line(intersect_points[l], u, v));
+    //            printf("tmp:%lf", tmp);
+                min_distance = dis + max_dis;
+            }
+
+            double kn = 1 - pow(dis / min_distance, -2);
+            if (min_distance < dis)
+                PROFILE_COUNT(prof, edge_misses, 1);
+            if (0 < kn)
+                continue;
+            assert(ZERO < abs(n.Normalize()));
+            double weight = calc_weight(min_distance, 1) + calc_weight(dis, 1);//pow(min_dist + 0.2, -2);
+            fx -= weight * kn * n.x;
+            fy -= weight * kn * n.y;
+            angle[i] += ang_diff * weight;
+            weight_sum += weight;
+            k_min[i] = min(k_min[i], dis / min_distance);
+            if (min_dist < 0.1)
+                del_rank[i].first.first++;
+            del_rank[i].first.second -= max(0.0, 1 - dis / min_distance);
+            energy[i] += max(0.0, 1 / (dis / min_distance) - 1);
+        }
+
+        if (ZERO < weight_sum) {
+            fx /= weight_sum;
+            fy /= weight_sum;
+            angle[i] /= weight_sum;
+        }
+        force[i] = Vector(fx, fy);
+        cached_energy[i] = energy[i];
+        cached_k_min[i] = k_min[i];
+        cached_rank[i] = del_rank[i].first;
+    }
+    for (int i = 0; i < points.size(); i++) {
+        s.E += energy[i];
+        s.K = min(s.K, k_min[i]);
+    }
+    s.E /= 2;
+
+    if (opt.sleep_modules)
+        for (int i = 0; i < points.size(); i++)
+            if (need[i]) {
+                const bool rest = force[i].Length() < SLEEP_SPEED && abs(to_rad(angle[i])) < SLEEP_SPIN;
+                calm[i] = rest ? calm[i] + 1 : 0;
+            }
+    for (int i = 0; i < points.size(); i++)
+        if (moving(i)) {
+            velocity[i] = force[i];
+            spin[i] = to_rad(angle[i]);
+        } else {
+            velocity[i] = Vector(0, 0);
+            spin[i] = 0;
+        }
+    PROFILE_LAP(forces);
+
+    sort(del_rank.begin(), del_rank.end());
+    double sum = 0;
+    for (int i = 0; i < del_rank.size(); i++)
+        sum += del_rank[i].first.second;
+    int del = -1;
+    for (int i = 0; i < del_rank.size() && del == -1; i++)
+        if (abs(sum / del_rank.size()) <= abs(del_rank[i].first.second))
+            del = del_rank[i].second;
+    if (s.pre_del.first == del)
+        s.pre_del.second++;
+    else
+        s.pre_del = pair<int, int>(del, 1);
+    if (s.frame % 10000 == 0) {
+        show_time();
+        cout << s.frame << endl;
+    }
+    if (s.E < s.min_E) {
+        s.min_t = 0;
+        s.min_K = s.K;
+        pending = in_front;
+    } else {
+        s.min_t++;
+        if (pending == in_back) {
+            // assign keeps the capacity and grows it when palette modules have raised the count
+            s.min_p.assign(back_points.begin(), back_points.end());
+            s.min_a.assign(back_angles.begin(), back_angles.end());
+            pending = none;
+        }
+    }
+    s.min_E = min(s.min_E, s.E);
+    s.pause_time += exp(1 - s.E / s.pre_E) < rand_unit(s.rng);
+    // sampled before a plateau changes the state, every plateau is traced along with the samples
+    const bool sample = s.frame % trace_every == 0;
+    TraceRow row = {s.stime, s.frame, int(points.size()), s.E, s.K, s.min_E, s.pause_time, s.pre_del.first, s.pre_del.second, "step"};
+//    if ((/*K > 0.95||*/s.frame > 60001+100)&&INT_MAX && s.frame--)
+//        for (int i = 0; i < points.size(); i++) {
+//            b2Body *p = points[i];
+//            p->SetLinearVelocity(Vector(0, 0));
+//            p->SetAngularVelocity(0);
+//        }
+    // the rest of the modules was at rest before the deletion, so once the hole has settled the plateau
+    // counters simply go on with global stepping
+    if (!active.empty() && (LOCAL_PATIENCE < s.min_t || LOCAL_FRAMES < ++local_frames))
+        active.clear();
+    // no deletion while part of the modules is frozen; without any module there is nothing to wait for, only the
+    // palette sizes may still fit
+    if (active.empty() && (points.empty() || (s.pre_del.first != -1 && (pow(points.size(), 2) < s.pause_time || 120*60 < s.min_t)))) {
+        Points holes;
+        if (s.K < opt.keep_K && 0 < swapped) {
+            // the smaller modules did not settle in the holes either: take them out, the plain deletion anneals on
+            for (; 0 < swapped; swapped--) {
+                holes.push_back(points.back());
+                remove(points.size() - 1);
+            }
+            new_plateau();
+            wake_around(holes);
+            PROFILE_COUNT(prof, rejections, 1);
+            row.event = "reject";
+        } else {
+            swapped = 0;
+            if (s.K < opt.keep_K && !trial_p.empty()) {
+                // the last inserted module did not settle in, the converged layout before it is what counts; del and
+                // the rest of this frame's evaluation belong to the layout just dropped, the next plateau starts afresh
+                restore_trial();
+                new_plateau();
+                PROFILE_COUNT(prof, rejections, 1);
+                row.event = "reject";
+            } else if (s.K < .85) {
+                new_plateau();
+                vector<int> dels(1, del);
+                if (opt.batch_delete) {
+                    // modules scaled down by their mean k_min just fit, so about n (1 - k^2) too many; K itself is set by
+                    // the single worst pair and sits near 0 on the first plateaus. Take half of that, at most
+                    // BATCH_FRACTION of the modules per plateau so the next plateau estimates again, one at a time
+                    // once K passes 0.7, and never both modules of one overlap
+                    double k = 0;
+                    for (int i = 0; i < points.size(); i++)
+                        k += min(1.0, k_min[i]);
+                    k /= points.size();
+                    const int n = s.K < 0.7 ? max(1, int(min(0.5 * (1 - k * k), BATCH_FRACTION) * points.size())) : 1;
+                    vector<char> chosen(points.size(), 0);
+                    chosen[del] = 1;
+                    for (int i = 0; i < del_rank.size() && dels.size() < n; i++) {
+                        const int j = del_rank[i].second;
+                        if (chosen[j] || abs(sum / del_rank.size()) > abs(del_rank[i].first.second))
+                            continue;
+                        bool near = false;
+                        for (int k = 0; k < overlap_module[j].size() && !near; k++)
+                            near = chosen[overlap_module[j][k]];
+                        if (!near) {
+                            chosen[j] = 1;
+                            dels.push_back(j);
+                        }
+                    }
+                }
+                // swap-pop removal, highest index first keeps the others in place
+                sort(dels.rbegin(), dels.rend());
+                vector<double> hole_scales;
+                for (int i = 0; i < dels.size(); i++) {
+                    holes.push_back(points[dels[i]]);
+                    hole_scales.push_back(scale_[dels[i]]);
+                    remove(dels[i]);
+                }
+                PROFILE_COUNT(prof, deletions, dels.size());
+                // with a palette, smaller modules take the place of the ones that kept overlapping once the layout is
+                // close (K >= 0.7); before that the modules are simply too many
+                if (0.7 <= s.K && !opt.size_palette.empty()) {
+                    index_layout();
+                    for (int h = 0; h < holes.size(); h++)
+                        swapped += refill(holes[h], hole_scales[h]);
+                }
+                PROFILE_COUNT(prof, insertions, swapped);
+                wake_around(holes);
+                row.event = "delete";
+            } else if (insert(holes)) {
+                // converged with room to spare: anneal again with the new module, kept if K gets back to keep_K
+                new_plateau();
+                wake_around(holes);
+                PROFILE_COUNT(prof, insertions, 1);
+                row.event = "insert";
+            } else {
+                ret = false;
+                row.event = "converge";
+            }
+        }
+        velocity.assign(points.size(), Vector(0, 0));
+        spin.assign(points.size(), 0);
+    } else
+        s.frame++;
+    if (trace != NULL && (sample || strcmp(row.event, "step"))) {
+        trace_rows.push_back(row);
+        if (TRACE_CHUNK <= trace_rows.size())
+            trace->hand_over(trace_rows, false);
+    }
+    PROFILE_LAP(annealing);
+    return ret;
+}
+
+template <int N>
+void Placer<N>::place() {
+    assert(2 < polygon.size());
+
+    show_time();
+    printf("start place ...\n");
+    Point plb = normalized_polygon[0],
+          prt = normalized_polygon[0];
+    for (int i = 1; i < normalized_polygon.size(); i++) {
+        const Point &p = normalized_polygon[i];
+        plb.x = min(plb.x, p.x);
+        plb.y = min(plb.y, p.y);
+        prt.x = max(prt.x, p.x);
+        prt.y = max(prt.y, p.y);
+    }
+    printf("(%lf, %lf)<->(%lf, %lf)\n", plb.x, plb.y, prt.x, prt.y);
+
+    s.stime = (s.stime != -1 ? s.stime : time(NULL));
+    s.rng.seed(s.stime);//time(NULL));
+
+    double area = area_polygon(normalized_polygon);
+    printf("accurate area = %.6lf\n", area);
+
+    // only triangles have their tiling here, other shapes start from random poses
+    if (opt.lattice_start && N == 3 && lattice_layout(normalized_polygon, edges, points, angles_)) {
+        printf("lattice start with %d points\n", int(points.size()));
+    } else {
+        int point_number = int(area / shape.area);
+        // the first frame finds the border empty and converges (or tries the palette sizes)
+        if (point_number <= 0) {
+            printf("border too small for a module\n");
+            point_number = 0;
+        }
+        points.assign(point_number, Point(0, 0));
+        angles_.assign(point_number, 0);
+        for (int i = 0; i < points.size(); i++) {
+            points[i] = sampler.sample(s.rng);
+            // stored as float like a body angle, so both integrators start from the same poses
+            angles_[i] = float32(2 * pi * rand_unit(s.rng));
+        }
+    }
+    scale_.assign(points.size(), 1);
+    velocity.assign(points.size(), Vector(0, 0));
+    spin.assign(points.size(), 0);
+
+#ifndef ITPLA_NO_BOX2D
+    create_world();
+#endif
+
+    show_time();
+    printf("start evolove ...\n");
+
+/*    float32 timeStep = 1.0f / 60.0f;
+    int32 velocityIterations = 6;
+    int32 positionIterations = 2;
+
+    for (int i = 0; i < 600; i++) {
+        calc_next_step(points);
+        world->Step(timeStep, velocityIterations, positionIterations);
+    }
+*/
+    show_time();
+    printf("end evolove\n");
+    printf("contain %d points\n", int(points.size()));
+    printf("stime = %d\n", int(s.stime));
+}
+
+#ifndef ITPLA_NO_BOX2D
+// (re)builds the b2World with the border edges and one body per module pose
+template <int N>
+void Placer<N>::create_world() {
+    show_time();
+    printf("create world ...\n");
+    delete world;
+    Vector gravity(0, 0);
+    world = new b2World(gravity);
+
+    b2BodyDef border_def;
+    border_def.position.Set(0, 0);
+    b2Body *border = world->CreateBody(&border_def);
+    for (int i = 0; i < normalized_polygon.size(); i++) {
+        const Point &u = normalized_polygon[i],
+                    &v = normalized_polygon[(i + 1) % normalized_polygon.size()];
+        b2EdgeShape border_edge_shape;
+        border_edge_shape.Set(u, v);
+        b2Fixture *border_edge_fixture = border->CreateFixture(&border_edge_shape, 0);
+        border_edge_fixture->SetFriction(0);
+        border_edge_fixture->SetRestitution(0);
+    }
+
+    bodies.assign(points.size(), NULL);
+    for (int i = 0; i < bodies.size(); i++)
+        bodies[i] = create_body(points[i], angles_[i]);
+}
+
+template <int N>
+b2Body *Placer<N>::create_body(const Point &p, const double angle) {
+    b2BodyDef point_def;
+    point_def.type = b2_dynamicBody;
+    point_def.position.Set(p.x, p.y);
+    point_def.angle = angle;
+    b2Body *body = world->CreateBody(&point_def);
+    b2CircleShape point_shape;
+    point_shape.m_p.Set(0, 0);
+    point_shape.m_radius = 0.1;
+    body->CreateFixture(&point_shape, 1);
+    return body;
+}
+#endif
+
+template <int N>
+Placer<N>::Placer(const Points &polygon, double edge_length, time_t stime, const Options &options) :
+    shape(shape_of<N>()),
+    // the sampler, the lattice and the edge forces need a counterclockwise border, whatever the caller passed
+    polygon(orient_polygon(polygon)),
+    normalized_polygon(normalize_polygon(orient_polygon(polygon), edge_length / shape.edge)),
+    edge_length(edge_length),
+    opt(order_palette(options)),
+    edges(normalized_polygon, 2 * MODULE_RADIUS),
+    sampler(normalized_polygon),
+    pending(none),
+#ifndef ITPLA_NO_BOX2D
+    world(NULL),
+#endif
+    trace(NULL),
+    trace_every(100),
+    local_frames(0),
+    trial_K(0),
+    insert_from(0),
+    swapped(0),
+    converged(false) {
+    s.stime = stime;
+    place();
+}
+
+template <int N>
+Placer<N>::~Placer() {
+    trace_to(NULL);
+#ifndef ITPLA_NO_BOX2D
+    delete world;
+#endif
+}
+
+// advances the poses by one time step with the velocities left by calc_next_step
+template <int N>
+void Placer<N>::integrate() {
+    PROFILE_SCOPE(prof, integrate);
+    back_points.resize(points.size());
+    back_angles.resize(points.size());
+#ifdef ITPLA_NO_BOX2D
+    // explicit Euler step, clamped per step like b2World::Step; the border is kept by the edge forces alone
+    for (int i = 0; i < points.size(); i++) {
+        Vector translation = float32(TIME_STEP) * velocity[i];
+        if (b2_maxTranslation * b2_maxTranslation < translation.LengthSquared())
+            translation *= b2_maxTranslation / translation.Length();
+        float32 rotation = float32(TIME_STEP) * float32(spin[i]);
+        if (b2_maxRotation * b2_maxRotation < rotation * rotation)
+            rotation *= b2_maxRotation / abs(rotation);
+        back_points[i] = points[i] + translation;
+        back_angles[i] = float32(angles_[i] + rotation);
+    }
+#else
+    for (int i = 0; i < bodies.size(); i++) {
+        bodies[i]->SetLinearVelocity(velocity[i]);
+        bodies[i]->SetAngularVelocity(spin[i]);
+    }
+    world->Step(TIME_STEP, 6, 2);
+    for (int i = 0; i < bodies.size(); i++) {
+        back_points[i] = bodies[i]->GetPosition();
+        back_angles[i] = bodies[i]->GetAngle();
+    }
+#endif
+    points.swap(back_points);
+    angles_.swap(back_angles);
+    if (pending == in_front)
+        pending = in_back;
+}
+
+// appends a module at rest, the counterpart of remove
+template <int N>
+void Placer<N>::add(const Point &p, const double angle, const double scale) {
+#ifndef ITPLA_NO_BOX2D
+    bodies.push_back(create_body(p, angle));
+#endif
+    points.push_back(p);
+    angles_.push_back(angle);
+    scale_.push_back(scale);
+    velocity.push_back(Vector(0, 0));
+    spin.push_back(0);
+    cached_energy.push_back(0);
+    cached_k_min.push_back(1);
+    cached_rank.push_back(make_pair(0, 0.0));
+    if (!active.empty())
+        active.push_back(1);
+    calm.push_back(0);
+}
+
+// the corners of a module of size scale at (c, angle), in the order of Shape
+template <int N>
+void Placer<N>::corners(const Point &c, const double angle, const double scale, Point *v) const {
+    const double (&corner_turn)[N][2] = shape.corner_turn;
+    const double sa = sin(angle),
+                 ca = cos(angle);
+    for (int k = 0; k < N; k++)
+        v[k] = c + float32(scale) * Vector(sa * corner_turn[k][0] + ca * corner_turn[k][1], ca * corner_turn[k][0] - sa * corner_turn[k][1]);
+}
+
+// grid and g over the layout as it is now, after the module set has changed within a frame
+template <int N>
+void Placer<N>::index_layout() {
+    grid.build(points, 2 * MODULE_RADIUS);
+    g.build(points, angles_, scale_);
+}
+
+// add, and into grid and g as well, so the next fits sees the module
+template <int N>
+void Placer<N>::add_indexed(const Point &p, const double angle, const double scale) {
+    add(p, angle, scale);
+    grid.add(p, points.size() - 1);
+    g.add(p, angle, scale);
+}
+
+// whether a module of size scale at (c, angle) lies inside the border and clear of every module in the cells around c
+template <int N>
+bool Placer<N>::fits(const Point &c, const double angle, const double scale, vector<int> &near_edges) const {
+    Point v[N];
+    corners(c, angle, scale, v);
+    if (!edges.contains(c))
+        return false;
+    // overlapping modules are less than 2 * MODULE_RADIUS, one cell, apart
+    int x, y;
+    grid.locate(c, x, y);
+    bool clear = true;
+    const auto check = [&](const int j) {
+        clear = clear && !((g.position[j] - c).Length() < MODULE_RADIUS * (scale + g.scale[j]) && intersect_each<N>(v, &g.vertex[N * j]));
+    };
+    for (int r = 0; r <= 1; r++)
+        grid.for_ring(x, y, r, check);
+    if (!clear)
+        return false;
+    Point lo = v[0], hi = v[0];
+    for (int k = 1; k < N; k++) {
+        lo = Point(min(lo.x, v[k].x), min(lo.y, v[k].y));
+        hi = Point(max(hi.x, v[k].x), max(hi.y, v[k].y));
+    }
+    edges.query(lo, hi, near_edges);
+    for (int m = 0; m < near_edges.size(); m++) {
+        const int j = near_edges[m];
+        if (intersect_each<N>(v, normalized_polygon[j], normalized_polygon[(j + 1) % normalized_polygon.size()]))
+            return false;
+    }
+    return true;
+}
+
+// after the modules have converged, one palette module goes into the space left over: the first size in palette order
+// still allowed first, INSERT_TRIES random poses per size, placed at the first one that overlaps no module and no border
+// edge. It stays on trial until the next plateau, and the layout it was added to is kept until then. The module set
+// has not changed since grid and g were built this frame
+template <int N>
+bool Placer<N>::insert(Points &holes) {
+    const vector<double> &palette = opt.size_palette;
+    const Result before = best();
+    vector<int> near_edges;
+    for (int p = insert_from; p < palette.size(); p++)
+        for (int t = 0; t < INSERT_TRIES; t++) {
+            const Point c = sampler.sample(s.rng);
+            const double a = float32(2 * pi * rand_unit(s.rng));
+            if (fits(c, a, palette[p], near_edges)) {
+                trial_p = before.positions;
+                trial_a = before.angles;
+                trial_s = scale_;
+                trial_K = before.K;
+                insert_from = p;
+                add(c, a, palette[p]);
+                holes.push_back(c);
+                return true;
+            }
+        }
+    trial_p.clear();
+    return false;
+}
+
+// the hole of a module deleted for persistent overlap goes to the palette sizes below its own, in palette order:
+// INSERT_TRIES random poses per size within the circle the deleted module reached, and every pose that is free
+// takes a module, so one large module can give way to several small ones. They are on trial like an insert: if the
+// next plateau still ends below keep_K they are taken out again. Returns the number of modules added; the layout
+// has to be indexed after the deletions
+template <int N>
+int Placer<N>::refill(const Point &hole, const double scale) {
+    const vector<double> &palette = opt.size_palette;
+    int added = 0;
+    vector<int> near_edges;
+    for (int p = 0; p < palette.size(); p++) {
+        if (scale <= palette[p])
+            continue;
+        // centres within reach keep the new module inside the circle of the deleted one
+        const double reach = MODULE_RADIUS * (scale - palette[p]);
+        for (int t = 0; t < INSERT_TRIES; t++) {
+            const double r = reach * sqrt(rand_unit(s.rng)),
+                         d = 2 * pi * rand_unit(s.rng);
+            const Point c = hole + Point(float32(r * cos(d)), float32(r * sin(d)));
+            const double a = float32(2 * pi * rand_unit(s.rng));
+            if (fits(c, a, palette[p], near_edges)) {
+                add_indexed(c, a, palette[p]);
+                added++;
+            }
+        }
+    }
+    return added;
+}
+
+// takes the module on trial out again by going back to the layout it was added to, smaller sizes go next
+template <int N>
+void Placer<N>::restore_trial() {
+    points = trial_p;
+    angles_ = trial_a;
+    scale_ = trial_s;
+    velocity.assign(points.size(), Vector(0, 0));
+    spin.assign(points.size(), 0);
+    cached_energy.assign(points.size(), 0);
+    cached_k_min.assign(points.size(), 1);
+    cached_rank.assign(points.size(), make_pair(0, 0.0));
+    active.clear();
+    calm.assign(points.size(), 0);
+    s.K = s.min_K = trial_K;
+    trial_p.clear();
+    insert_from++;
+#ifndef ITPLA_NO_BOX2D
+    create_world();
+#endif
+}
+
+// annealing starts over after the module set has changed
+template <int N>
+void Placer<N>::new_plateau() {
+    s.pre_del.second = 0;
+    s.pause_time = 0;
+    s.pre_E = INT_MAX;
+    s.min_E = INT_MAX;
+    s.min_t = 0;
+    s.min_p.clear();
+    s.min_a.clear();
+    pending = none;
+}
+
+// a module left or arrived at each of holes: the modules around wake up, and with local_relax only they move
+template <int N>
+void Placer<N>::wake_around(const Points &holes) {
+    for (int i = 0; i < points.size(); i++)
+        for (int h = 0; h < holes.size(); h++)
+            if ((points[i] - holes[h]).Length() < LOCAL_RADIUS)
+                calm[i] = 0;
+    if (opt.local_relax) {
+        active.assign(points.size(), 0);
+        bool any = false;
+        for (int i = 0; i < points.size(); i++)
+            for (int h = 0; h < holes.size() && !active[i]; h++)
+                any |= active[i] = (points[i] - holes[h]).Length() < LOCAL_RADIUS;
+        local_frames = 0;
+        if (!any)
+            active.clear();
+    }
+}
+
+// drops module i, the last module takes its index
+template <int N>
+void Placer<N>::remove(int i) {
+#ifndef ITPLA_NO_BOX2D
+    world->DestroyBody(bodies[i]);
+    bodies[i] = bodies.back();
+    bodies.pop_back();
+#endif
+    points[i] = points.back();
+    points.pop_back();
+    angles_[i] = angles_.back();
+    angles_.pop_back();
+    scale_[i] = scale_.back();
+    scale_.pop_back();
+    velocity[i] = velocity.back();
+    velocity.pop_back();
+    spin[i] = spin.back();
+    spin.pop_back();
+    cached_energy[i] = cached_energy.back();
+    cached_energy.pop_back();
+    cached_k_min[i] = cached_k_min.back();
+    cached_k_min.pop_back();
+    cached_rank[i] = cached_rank.back();
+    cached_rank.pop_back();
+    if (!active.empty()) {
+        active[i] = active.back();
+        active.pop_back();
+    }
+    calm[i] = calm.back();
+    calm.pop_back();
+}
+
+// one frame; false once the placement has converged
+template <int N>
+bool Placer<N>::step() {
+    if (converged || !calc_next_step()) {
+        if (trace != NULL && !trace_rows.empty())
+            trace->hand_over(trace_rows, true);
+        converged = true;
+        return false;
+    }
+    integrate();
+    return true;
+}
+
+template <int N>
+void Placer<N>::trace_to(TraceWriter *trace, int every) {
+    if (this->trace != NULL && !trace_rows.empty())
+        this->trace->hand_over(trace_rows, true);
+    trace_rows.clear();
+    this->trace = trace;
+    trace_every = max(1, every);
+}
+
+// with a checkpoint file, resumes from it if it fits and saves to it every `every` steps and at the end
+template <int N>
+void Placer<N>::run_until_converged(const string &checkpoint, int every) {
+    if (checkpoint.empty()) {
+        while (step());
+        return;
+    }
+    if (load(checkpoint))
+        printf("resumed %s at frame %d\n", checkpoint.c_str(), s.frame);
+    for (int steps = 1; step(); steps++)
+        if (steps % every == 0 && !save(checkpoint))
+            fprintf(stderr, "cannot write %s\n", checkpoint.c_str());
+    save(checkpoint);
+}
+
+template <int N>
+Result Placer<N>::result() const {
+    Result res;
+    res.positions = points;
+    res.angles = angles_;
+    res.scales = scale_;
+    res.K = s.K;
+    res.frame = s.frame;
+    res.stime = s.stime;
+    res.profile = prof;
+    return res;
+}
+
+// the minimum energy layout since the last deletion, the current one if there is none yet
+template <int N>
+Result Placer<N>::best() const {
+    Result res = result();
+    if (pending == in_back) {
+        res.positions = back_points;
+        res.angles = back_angles;
+    } else if (pending == none && !s.min_p.empty()) {
+        res.positions = s.min_p;
+        res.angles = s.min_a;
+    }
+    if (pending != none || !s.min_p.empty())
+        res.K = s.min_K;
+    return res;
+}
+
+// start over on the same border, e.g. the next job of a long-lived worker
+template <int N>
+void Placer<N>::reset(time_t stime) {
+    // rows of the finished run go out under its own stime
+    trace_to(trace, trace_every);
+#ifndef ITPLA_NO_BOX2D
+    delete world;
+    world = NULL;
+    bodies.clear();
+#endif
+    points.clear();
+    s = State();
+    s.stime = stime;
+    prof = Profile();
+    pending = none;
+    active.clear();
+    calm.clear();
+    trial_p.clear();
+    insert_from = 0;
+    swapped = 0;
+    converged = false;
+    place();
+}
+
+// checkpoint layout, native byte order:
+//   "ITPLA" version:int32 sides:int32 edge_length:double border_size:int32
+//   K E pre_E min_E min_K:double  min_t frame pause_time pre_del.first pre_del.second:int32  stime:int64  converged:int8
+//   n:int32 n * (x y:float angle:double)  n * scale:double
+//   local_frames:int32  a:int32 a * active:int8  e:int32 e * cached_energy:double  k:int32 k * cached_k_min:double
+//   r:int32 r * (cached_rank count:int32 overlap:double)  c:int32 c * calm:int32
+//   t:int32 t * (x y:float angle:double)  t * scale:double  K:double  insert_from:int32 for the layout before a trial insert
+//   swapped:int32 modules on trial in the holes of the last deletion
+//   m:int32 m * (x y:float angle:double) for min_p / min_a
+//   rng_size:int32 rng_size * char, the mt19937 state as written by operator<<
+#define CHECKPOINT_VERSION 8
+
+template <class T>
+void write_raw(FILE *fout, const T &x) {
+    fwrite(&x, sizeof(T), 1, fout);
+}
+
+template <class T>
+bool read_raw(FILE *fin, T &x) {
+    return fread(&x, sizeof(T), 1, fin) == 1;
+}
+
+void write_poses(FILE *fout, const Points &positions, const vector<double> &angles) {
+    write_raw(fout, int32_t(positions.size()));
+    for (int i = 0; i < positions.size(); i++) {
+        write_raw(fout, float(positions[i].x));
+        write_raw(fout, float(positions[i].y));
+        write_raw(fout, double(angles[i]));
+    }
+}
+
+bool read_poses(FILE *fin, Points &positions, vector<double> &angles) {
+    int32_t n;
+    if (!read_raw(fin, n) || n < 0)
+        return false;
+    positions.resize(n);
+    angles.resize(n);
+    for (int i = 0; i < n; i++) {
+        float x, y;
+        if (!read_raw(fin, x) || !read_raw(fin, y) || !read_raw(fin, angles[i]))
+            return false;
+        positions[i] = Point(x, y);
+    }
+    return true;
+}
+
+template <class T>
+void write_array(FILE *fout, const vector<T> &x) {
+    write_raw(fout, int32_t(x.size()));
+    for (int i = 0; i < x.size(); i++)
+        write_raw(fout, x[i]);
+}
+
+template <class T>
+bool read_array(FILE *fin, vector<T> &x) {
+    int32_t n;
+    if (!read_raw(fin, n) || n < 0)
+        return false;
+    x.resize(n);
+    for (int i = 0; i < n; i++)
+        if (!read_raw(fin, x[i]))
+            return false;
+    return true;
+}
+
+bool read_scales(FILE *fin, vector<double> &scales, const int n) {
+    scales.resize(n);
+    for (int i = 0; i < n; i++)
+        if (!read_raw(fin, scales[i]))
+            return false;
+    return true;
+}
+
+// written to filename.tmp first and renamed over filename, so a crash never leaves a torn checkpoint;
+// on windows the old file has to go first, and a crash right then leaves only filename.tmp behind
+template <int N>
+bool Placer<N>::save(const string &filename) const {
+    const string tmp = filename + ".tmp";
+    FILE *fout = fopen(tmp.c_str(), "wb");
+    if (fout == NULL)
+        return false;
+    fwrite("ITPLA", 1, 5, fout);
+    write_raw(fout, int32_t(CHECKPOINT_VERSION));
+    write_raw(fout, int32_t(N));
+    write_raw(fout, double(edge_length));
+    write_raw(fout, int32_t(polygon.size()));
+    write_raw(fout, s.K);
+    write_raw(fout, s.E);
+    write_raw(fout, s.pre_E);
+    write_raw(fout, s.min_E);
+    write_raw(fout, s.min_K);
+    write_raw(fout, int32_t(s.min_t));
+    write_raw(fout, int32_t(s.frame));
+    write_raw(fout, int32_t(s.pause_time));
+    write_raw(fout, int32_t(s.pre_del.first));
+    write_raw(fout, int32_t(s.pre_del.second));
+    write_raw(fout, int64_t(s.stime));
+    write_raw(fout, int8_t(converged));
+    write_poses(fout, points, angles_);
+    for (int i = 0; i < scale_.size(); i++)
+        write_raw(fout, scale_[i]);
+    // a run resumed in the middle of a local relaxation freezes the same modules and reuses their last evaluation
+    write_raw(fout, int32_t(local_frames));
+    write_array(fout, active);
+    write_array(fout, cached_energy);
+    write_array(fout, cached_k_min);
+    write_raw(fout, int32_t(cached_rank.size()));
+    for (int i = 0; i < cached_rank.size(); i++) {
+        write_raw(fout, int32_t(cached_rank[i].first));
+        write_raw(fout, cached_rank[i].second);
+    }
+    // and a sleeping module stays asleep
+    write_array(fout, calm);
+    // and a module still on trial can still be taken out again
+    write_poses(fout, trial_p, trial_a);
+    for (int i = 0; i < trial_p.size(); i++)
+        write_raw(fout, trial_s[i]);
+    write_raw(fout, trial_K);
+    write_raw(fout, int32_t(insert_from));
+    write_raw(fout, int32_t(swapped));
+    if (pending == none)
+        write_poses(fout, s.min_p, s.min_a);
+    else {
+        Result min_layout = best();
+        write_poses(fout, min_layout.positions, min_layout.angles);
+    }
+    ostringstream rng;
+    rng << s.rng;
+    write_raw(fout, int32_t(rng.str().size()));
+    fwrite(rng.str().data(), 1, rng.str().size(), fout);
+    bool ok = !ferror(fout);
+    ok = fclose(fout) == 0 && ok;
+    if (!ok)
+        return false;
+#ifdef _WIN32
+    // rename does not replace an existing file on windows; elsewhere it does so atomically
+    std::remove(filename.c_str());
+#endif
+    return rename(tmp.c_str(), filename.c_str()) == 0;
+}
+
+// picks up a run saved by save() on the same border; false (and nothing changed) if the file does not fit
+template <int N>
+bool Placer<N>::load(const string &filename) {
+    FILE *fin = fopen(filename.c_str(), "rb");
+    if (fin == NULL)
+        return false;
+    char magic[5];
+    int32_t version, sides, border_size, min_t, frame, pause_time, del_first, del_second, relaxed, ranks, from, refilled, rng_size;
+    double length;
+    int64_t seed;
+    int8_t done;
+    State t;
+    Points positions, before;
+    vector<double> angles, scales, energies, k_mins, before_angles, before_scales;
+    double before_K;
+    vector<char> movable;
+    vector<pair<int, double> > rank;
+    vector<int> rest;
+    bool ok = fread(magic, 1, 5, fin) == 5 && !strncmp(magic, "ITPLA", 5) &&
+              read_raw(fin, version) && version == CHECKPOINT_VERSION &&
+              read_raw(fin, sides) && sides == N &&
+              read_raw(fin, length) && length == edge_length &&
+              read_raw(fin, border_size) && border_size == polygon.size() &&
+              read_raw(fin, t.K) && read_raw(fin, t.E) && read_raw(fin, t.pre_E) && read_raw(fin, t.min_E) && read_raw(fin, t.min_K) &&
+              read_raw(fin, min_t) && read_raw(fin, frame) && read_raw(fin, pause_time) &&
+              read_raw(fin, del_first) && read_raw(fin, del_second) && read_raw(fin, seed) && read_raw(fin, done) &&
+              read_poses(fin, positions, angles) && read_scales(fin, scales, positions.size()) &&
+              read_raw(fin, relaxed) && read_array(fin, movable) && (movable.empty() || movable.size() == positions.size()) &&
+              read_array(fin, energies) && read_array(fin, k_mins) && read_raw(fin, ranks) && 0 <= ranks;
+    rank.resize(ok ? ranks : 0);
+    for (int i = 0; i < rank.size() && ok; i++) {
+        int32_t count;
+        ok = read_raw(fin, count) && read_raw(fin, rank[i].second);
+        rank[i].first = count;
+    }
+    ok = ok && read_array(fin, rest) && read_poses(fin, before, before_angles) &&
+         read_scales(fin, before_scales, before.size()) && read_raw(fin, before_K) && read_raw(fin, from) &&
+         read_raw(fin, refilled) && 0 <= refilled && refilled <= positions.size() &&
+         read_poses(fin, t.min_p, t.min_a) && read_raw(fin, rng_size) && 0 <= rng_size;
+    string rng(ok ? rng_size : 0, ' ');
+    ok = ok && fread(&rng[0], 1, rng_size, fin) == rng_size;
+    fclose(fin);
+    // the per-module caches are indexed by module, empty only before the first frame; the minimum layout goes with
+    // the current scales, and the layout before a trial insert has fewer modules than the one on trial
+    const int n = positions.size();
+    ok = ok && (energies.empty() || energies.size() == n) && (k_mins.empty() || k_mins.size() == n) &&
+         (rank.empty() || rank.size() == n) && (rest.empty() || rest.size() == n) &&
+         (t.min_p.empty() || t.min_p.size() == n) && (before.empty() || (before.size() < n && 0 <= from));
+    if (!ok)
+        return false;
+    istringstream(rng) >> t.rng;
+
+    t.min_t = min_t;
+    t.frame = frame;
+    t.pause_time = pause_time;
+    t.pre_del = pair<int, int>(del_first, del_second);
+    t.stime = seed;
+    s = t;
+    converged = done;
+    pending = none;
+    active = movable;
+    local_frames = relaxed;
+    cached_energy = energies;
+    cached_k_min = k_mins;
+    cached_rank = rank;
+    calm = rest;
+    trial_p = before;
+    trial_a = before_angles;
+    trial_s = before_scales;
+    trial_K = before_K;
+    insert_from = from;
+    swapped = refilled;
+    points = positions;
+    angles_ = angles;
+    scale_ = scales;
+    velocity.assign(points.size(), Vector(0, 0));
+    spin.assign(points.size(), 0);
+#ifndef ITPLA_NO_BOX2D
+    create_world();
+#endif
+    return true;
+}
+
+// covered area in full size modules, the module count when no module was shrunk
+double coverage(const Result &res) {
+    double area = 0;
+    for (int i = 0; i < res.scales.size(); i++)
+        area += res.scales[i] * res.scales[i];
+    return area;
+}
+
+// more coverage first, then the better final K
+bool better(const Result &a, const Result &b) {
+    if (coverage(a) != coverage(b))
+        return coverage(a) > coverage(b);
+    return a.K > b.K;
+}
+
+// runs independent placements seeded stime, stime + 1, ... (the current time for stime = -1) on a pool of threads
+// and keeps the best, run r checkpoints to checkpoint.r (just checkpoint for a single run) when a file name is given
+template <int N>
+Result place_best(const Points &polygon, double edge_length, const int runs, const time_t stime = -1,
+                  int threads = thread::hardware_concurrency(),
+                  const string &checkpoint = "", const int every = 10000, TraceWriter *trace = NULL, const int trace_every = 100,
+                  const Options &options = Options()) {
+    assert(0 < runs);
+    const time_t base = stime != -1 ? stime : time(NULL);
+    threads = max(1, min(threads, runs));
+    const bool nested = 1 < threads;
+    vector<Result> results(runs);
+    atomic<int> next(0);
+    auto worker = [&]() {
+#ifdef _OPENMP
+        // the runs already fill the cores, keep each one on its own thread
+        if (nested)
+            omp_set_num_threads(1);
+#endif
+        for (int r; (r = next++) < runs;) {
+            Placer<N> placer(polygon, edge_length, base + r, options);
+            placer.trace_to(trace, trace_every);
+            placer.run_until_converged(checkpoint.empty() || runs == 1 ? checkpoint : checkpoint + "." + to_string(r), every);
+            results[r] = placer.best();
+        }
+    };
+    // nested runs all go to pool threads, so omp_set_num_threads never touches the caller's thread
+    vector<thread> pool;
+    if (nested)
+        for (int t = 0; t < threads; t++)
+            pool.push_back(thread(worker));
+    else
+        worker();
+    for (int t = 0; t < pool.size(); t++)
+        pool[t].join();
+
+    int best = 0;
+    for (int r = 1; r < runs; r++)
+        if (better(results[r], results[best]))
+            best = r;
+    return results[best];
+}
+
+}
+
+#endif // __ITPLA_H__
@@ -0,0 +1,98 @@
+#include <cstdlib>
+#include <cstring>
+#include "ITPLA.h"
+#include "options.h"
+using namespace ITPLA;
+
+// the shipped borders with the edge lengths used in mainwidget.cpp
+struct Case {
+    const char *name;
+    Points polygon;
+    double edge_length;
+};
+
+void usage(const char *name) {
+    fprintf(stderr, "usage: %s [output_file] [-s first_stime] [-n seeds] [-f max_frames] [-p polygon] %s\n", name, OPTION_SYNOPSIS);
+    fprintf(stderr, "  -s stime      seed of the first run of every polygon (default: 1)\n");
+    fprintf(stderr, "  -n seeds      runs per polygon, seeded stime, stime + 1, ... (default: 3)\n");
+    fprintf(stderr, "  -f frames     stop a run after this many steps even if it has not converged (default: no limit)\n");
+    fprintf(stderr, "  -p polygon    only run this polygon (test, LH, tr1_1, tr1_2, tr1_4, tr1_5)\n");
+    option_usage(14);
+    exit(-1);
+}
+
+int main(int argc, char *argv[]) {
+    const char *output = NULL,
+               *only = NULL;
+    time_t first = 1;
+    Options options;
+    int seeds = 3,
+        max_frames = INT_MAX;
+    for (int i = 1; i < argc; i++)
+        if (!strcmp(argv[i], "-s") && i + 1 < argc)
+            first = atol(argv[++i]);
+        else if (!strcmp(argv[i], "-n") && i + 1 < argc)
+            seeds = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-f") && i + 1 < argc)
+            max_frames = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-p") && i + 1 < argc)
+            only = argv[++i];
+        else if (parse_option(argc, argv, i, options, usage))
+            continue;
+        else if (output == NULL && argv[i][0] != '-')
+            output = argv[i];
+        else
+            usage(argv[0]);
+    if (seeds < 1 || max_frames < 1)
+        usage(argv[0]);
+
+    const Case cases[] = {
+        {"test", test, 100},
+        {"LH", LH, 99.9533},
+        {"tr1_1", tr1_1, 158.88},
+        {"tr1_2", accumulate_polygon(tr1_2), 63.17796},
+        {"tr1_4", accumulate_polygon(tr1_4), 85.86865},
+        {"tr1_5", accumulate_polygon(tr1_5), 68.983385775},
+    };
+
+    // Placer reports its progress on stdout, so the table goes to a file unless none is given
+    FILE *fout = output != NULL ? fopen(output, "w") : stdout;
+    if (fout == NULL) {
+        fprintf(stderr, "cannot open %s\n", output);
+        return -1;
+    }
+#ifndef ITPLA_PROFILE
+    fprintf(stderr, "built without ITPLA_PROFILE, the phase columns only hold zeros\n");
+#endif
+    fprintf(fout, "polygon,stime,steps,frame,converged,modules,K,wall_s,steps_per_s");
+    for (int i = 0; i < Profile::timers; i++)
+        fprintf(fout, ",%s_s", Profile::timer_name(i));
+    fprintf(fout, ",coverage\n");
+    for (const Case &c : cases) {
+        if (only != NULL && strcmp(only, c.name))
+            continue;
+        for (time_t seed = first; seed < first + seeds; seed++) {
+            Clock::time_point t = Clock::now();
+            Placer<SIDES> placer(orient_polygon(c.polygon), c.edge_length, seed, options);
+            int steps = 0;
+            bool running = true;
+            while (steps < max_frames && (running = placer.step()))
+                steps++;
+            double wall = lap(t);
+            fprintf(fout, "%s,%d,%d,%d,%d,%d,%.9lf,%.6lf,%.1lf",
+                    c.name, int(seed), steps, placer.state().frame, int(!running), int(placer.positions().size()),
+                    placer.state().K, wall, steps / wall);
+            for (int i = 0; i < Profile::timers; i++)
+                fprintf(fout, ",%.6lf", placer.profile().time[i]);
+            fprintf(fout, ",%.6lf\n", coverage(placer.result()));
+            fflush(fout);
+        }
+    }
+    if (fout != stdout)
+        fclose(fout);
+#ifdef ITPLA_CHECK_KERNELS
+    // every disagreement has already been reported on stderr by check_kernel
+    fprintf(stderr, "%lld CGAL calls checked\n", Profile::cgal_calls.load());
+#endif
+    return 0;
+}
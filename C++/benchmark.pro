@@ -0,0 +1,61 @@
+#-------------------------------------------------
+#
+# Benchmark over the shipped borders with fixed seeds, no Qt libraries linked
+#
+#-------------------------------------------------
+
+QT       -= core gui
+
+TARGET = benchmark
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle qt
+
+SOURCES += benchmark.cpp
+
+HEADERS  += ITPLA.h \
+    options.h
+
+# steps with Box2D like the GUI; qmake CONFIG+=nobox2d measures the built-in integrator of the headless build
+nobox2d: DEFINES += ITPLA_NO_BOX2D
+
+# the phase columns come from the per-phase timers of Profile
+DEFINES += ITPLA_PROFILE
+
+# qmake CONFIG+=checkkernels runs CGAL next to every closed-form overlap kernel, see test/check_kernels.sh
+checkkernels: DEFINES += ITPLA_CHECK_KERNELS
+
+include(native.pri)
+
+win32 {
+    QMAKE_CXXFLAGS += -std=c++11 -O2 -frounding-math -fopenmp
+    LIBS += -fopenmp
+    INCLUDEPATH += D:/Software/CGAL-4.5.2/include/
+    LIBS += -lCGAL -lCGAL_Core -lgmp
+    !nobox2d {
+        INCLUDEPATH += D:/
+        LIBS += -L"D:/Box2D" -lBox2D
+    }
+}
+
+unix:!macx {
+    QMAKE_CXXFLAGS += -std=c++11 -O2 -frounding-math -pthread -fopenmp
+    LIBS += -pthread -fopenmp
+    LIBS += -lCGAL -lCGAL_Core -lgmp
+    !nobox2d {
+        INCLUDEPATH += /mnt/Zero_Data
+        LIBS += -L"/mnt/Zero_Data/Box2D" -lBox2D
+    }
+}
+
+macx {
+    QMAKE_CXXFLAGS += -O2
+    CONFIG += c++11
+    INCLUDEPATH += /usr/local/include/
+    LIBS += -lgmp
+    LIBS += -L"/usr/local/lib" -lcgal -lcgal_Core
+    !nobox2d {
+        INCLUDEPATH += /Users/zero/Projects/Box2D-master
+        LIBS += -L"/Users/zero/Projects/Box2D-master/Box2D" -lBox2D
+    }
+}
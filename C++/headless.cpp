@@ -0,0 +1,117 @@
+#include <cstdlib>
+#include <cstring>
+#include "ITPLA.h"
+#include "options.h"
+using namespace ITPLA;
+
+void usage(const char *name) {
+    fprintf(stderr, "usage: %s border_file edge_length [output_file] [-r] %s [-s stime] [-n runs] [-j threads] [-c checkpoint] [-e every] [-P profile] [-t trace] [-T every]\n", name, OPTION_SYNOPSIS);
+    fprintf(stderr, "  -r          border file holds a start point followed by offsets\n");
+    option_usage(12);
+    fprintf(stderr, "              with -m the output gets a fourth column with the size\n");
+    fprintf(stderr, "  -s stime    random seed of the first run (default: current time)\n");
+    fprintf(stderr, "  -n runs     independent runs seeded stime, stime + 1, ...; the best is written (default: 1)\n");
+    fprintf(stderr, "  -j threads  runs evolved at the same time (default: all cores)\n");
+    fprintf(stderr, "  -c file     resume from and periodically save to file (file.r for run r of several)\n");
+    fprintf(stderr, "  -e every    frames between checkpoints (default: 10000)\n");
+    fprintf(stderr, "  -P file     write the phase timers and counters of the best run, CSV if file ends in .csv else JSON\n");
+    fprintf(stderr, "  -t file     write a CSV row of frame, modules, E, K, min_E, pause_time and deletion candidate per sample\n");
+    fprintf(stderr, "  -T every    frames between trace samples (default: 100)\n");
+    exit(-1);
+}
+
+int main(int argc, char *argv[]) {
+    vector<const char *> args;
+    Options options;
+    bool relative = false;
+    time_t stime = -1;
+    int runs = 1,
+        threads = thread::hardware_concurrency(),
+        every = 10000;
+    string checkpoint;
+    const char *profile = NULL,
+               *trace = NULL;
+    int trace_every = 100;
+    for (int i = 1; i < argc; i++)
+        if (!strcmp(argv[i], "-r"))
+            relative = true;
+        else if (parse_option(argc, argv, i, options, usage))
+            continue;
+        else if (!strcmp(argv[i], "-s") && i + 1 < argc)
+            stime = atol(argv[++i]);
+        else if (!strcmp(argv[i], "-n") && i + 1 < argc)
+            runs = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-j") && i + 1 < argc)
+            threads = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-c") && i + 1 < argc)
+            checkpoint = argv[++i];
+        else if (!strcmp(argv[i], "-e") && i + 1 < argc)
+            every = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-P") && i + 1 < argc)
+            profile = argv[++i];
+        else if (!strcmp(argv[i], "-t") && i + 1 < argc)
+            trace = argv[++i];
+        else if (!strcmp(argv[i], "-T") && i + 1 < argc)
+            trace_every = atoi(argv[++i]);
+        else
+            args.push_back(argv[i]);
+    if (args.size() < 2 || 3 < args.size() || runs < 1 || every < 1 || trace_every < 1)
+        usage(argv[0]);
+
+    Points polygon = read(args[0]);
+    double edge_length = atof(args[1]);
+    if (polygon.size() < 3 || edge_length <= 0) {
+        fprintf(stderr, "bad border file or edge length\n");
+        return -1;
+    }
+    if (relative)
+        polygon = accumulate_polygon(polygon);
+    polygon = orient_polygon(polygon);
+
+    TraceWriter *writer = NULL;
+    if (trace != NULL) {
+        writer = new TraceWriter(trace);
+        if (!writer->is_open()) {
+            fprintf(stderr, "cannot open %s\n", trace);
+            return -1;
+        }
+    }
+    Result res = place_best<SIDES>(polygon, edge_length, runs, stime, threads, checkpoint, every, writer, trace_every, options);
+    delete writer;
+
+    show_time();
+    printf("best of %d: stime = %d, frame %d, %d points, coverage %.6lf, K = %.6lf\n", runs, int(res.stime), res.frame, int(res.positions.size()), coverage(res), res.K);
+
+    FILE *fout = args.size() == 3 ? fopen(args[2], "w") : stdout;
+    if (fout == NULL) {
+        fprintf(stderr, "cannot open %s\n", args[2]);
+        return -1;
+    }
+    for (int i = 0; i < res.positions.size(); i++) {
+        Point p = normalize_point(res.positions[i], shape_of<SIDES>().edge / edge_length);
+        fprintf(fout, "%.6lf\t%.6lf\t%.6lf", p.x, p.y, to_deg(res.angles[i]));
+        if (!options.size_palette.empty())
+            fprintf(fout, "\t%.6lf", res.scales[i]);
+        fprintf(fout, "\n");
+    }
+    if (fout != stdout)
+        fclose(fout);
+
+    if (profile != NULL) {
+#ifndef ITPLA_PROFILE
+        fprintf(stderr, "built without ITPLA_PROFILE, %s only holds zeros\n", profile);
+#endif
+        FILE *fprof = fopen(profile, "w");
+        if (fprof == NULL) {
+            fprintf(stderr, "cannot open %s\n", profile);
+            return -1;
+        }
+        const size_t len = strlen(profile);
+        if (len >= 4 && !strcmp(profile + len - 4, ".csv"))
+            res.profile.write_csv(fprof);
+        else
+            res.profile.write_json(fprof);
+        fclose(fprof);
+    }
+    return 0;
+}
@@ -0,0 +1,46 @@
+#-------------------------------------------------
+#
+# Headless batch placement, no Qt or Box2D libraries linked
+#
+#-------------------------------------------------
+
+QT       -= core gui
+
+TARGET = headless
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle qt
+
+SOURCES += headless.cpp
+
+HEADERS  += ITPLA.h \
+    options.h
+
+# modules are stepped by the built-in integrator instead of a b2World
+DEFINES += ITPLA_NO_BOX2D
+
+include(native.pri)
+
+# qmake CONFIG+=profile compiles in the per-phase timers and counters dumped by -P
+profile: DEFINES += ITPLA_PROFILE
+
+win32 {
+    QMAKE_CXXFLAGS += -std=c++11 -O2 -frounding-math -fopenmp
+    LIBS += -fopenmp
+    INCLUDEPATH += D:/Software/CGAL-4.5.2/include/
+    LIBS += -lCGAL -lCGAL_Core -lgmp
+}
+
+unix:!macx {
+    QMAKE_CXXFLAGS += -std=c++11 -O2 -frounding-math -pthread -fopenmp
+    LIBS += -pthread -fopenmp
+    LIBS += -lCGAL -lCGAL_Core -lgmp
+}
+
+macx {
+    QMAKE_CXXFLAGS += -O2
+    CONFIG += c++11
+    INCLUDEPATH += /usr/local/include/
+    LIBS += -lgmp
+    LIBS += -L"/usr/local/lib" -lcgal -lcgal_Core
+}
@@ -2,55 +2,103 @@
 #include <QPainter>
 #include <QTimer>
 #include <QThread>
-#include <QMutex>
+#include <QKeyEvent>
 #include "ITPLA.h"
 using namespace ITPLA;
-Points polygon, normalized_polygon;
+Points polygon;
 double edge_length;
-vector<b2Body *> points;
+Placer<SIDES> *placer;
+const Shape<SIDES> &shape = shape_of<SIDES>();
 const int attention = -1;
 const int FRAMES_PER_SEC = 60;
+// toggled with T: the solver publishes nothing until it has converged, for runs only watched for the result
+atomic<bool> turbo(false);
+
+// one frame as the renderer sees it, in window coordinates
+struct snapshot {
+    std::pair<Points, std::vector<double> > ttt;
+    Vectors vel;
+    double K = 1, E = 0, run_time = 0;
+    int frame = 0;
+};
+
+// wait-free triple buffer: the solver fills back and swaps it with the middle slot, the renderer swaps
+// front with the middle slot only when a new frame was published, so neither side ever waits; the renderer
+// never allocates, the solver only when a frame has more modules than the slot it fills had before;
+// every read asks for one new frame, the solver copies a frame only when one was asked for
+class snapshot_channel {
+public:
+    snapshot_channel() : back(0), middle(1), front(2), requested(true) {}
+
+    bool due() { return requested.exchange(false); }
+    snapshot &writing() { return slot[back]; }
+    void publish() {
+        back = middle.exchange(back | fresh) & index;
+    }
+
+    const snapshot &reading() {
+        if (middle.load() & fresh)
+            front = middle.exchange(front) & index;
+        requested = true;
+        return slot[front];
+    }
+
+    // sizing every slot for the start layout avoids allocating while deletions shrink it, publish resizes the
+    // back slot when palette modules raise the count beyond;
+    // touches the front slot too, so only before the renderer and the solver start
+    void reserve(const int n) {
+        for (int i = 0; i < 3; i++) {
+            slot[i].ttt.first.reserve(n);
+            slot[i].ttt.second.reserve(n);
+            slot[i].vel.reserve(n);
+        }
+    }
+
+private:
+    static const int index = 3, fresh = 4;
+    snapshot slot[3];
+    int back;
+    std::atomic<int> middle;
+    int front;
+    std::atomic<bool> requested;
+};
 
 class placement_thread : public QThread {
 //    Q_OBJECT
 signals:
 public:
-    bool status = false;
-    double run_time = 0;
-    QMutex lock;
-    struct {
-        int status = 0;
-        std::pair<Points, std::vector<double> > ttt;
-        Vectors vel;
-        double K, E;
-    } buffer[3];
+    std::atomic<bool> status{false};
+    snapshot_channel channel;
     void run() {
-        double start_time = clock() * 1.0 / CLOCKS_PER_SEC;
-        while (status && ITPLA::calc_next_step(normalized_polygon, points)) {
-            points.back()->GetWorld()->Step(1.0 / FRAMES_PER_SEC, 6, 2);
-            lock.lock();
-            int writing = 0;
-            while (writing < 2 && buffer[writing].status != 1)
-                writing++;
-            int idle = 0;
-            while (idle < 2 && buffer[idle].status)
-                idle++;
-            buffer[writing].status = 0;
-            buffer[idle].status = 1;
-            run_time = clock() * 1.0 / CLOCKS_PER_SEC - start_time;
-            lock.unlock();
-            buffer[idle].ttt.first.clear();
-            buffer[idle].ttt.second.clear();
-            buffer[idle].vel.clear();
-            for (int i = 0; i < points.size(); i++) {
-                buffer[idle].ttt.first.push_back(ITPLA::normalize_point(points[i]->GetPosition(), sqrt(3) / edge_length));
-                //        printf("%lf,%lf\n",points[i]->GetAngle(),points[i]->GetPosition().y);
-                buffer[idle].ttt.second.push_back(to_deg(points[i]->GetAngle()));
-                buffer[idle].vel.push_back(ITPLA::normalize_point(points[i]->GetLinearVelocity(), sqrt(3) / edge_length));
-            }
-            buffer[idle].K = ITPLA::K;
-            buffer[idle].E = ITPLA::E;
+        start_time = clock() * 1.0 / CLOCKS_PER_SEC;
+        while (status && placer->step())
+            if (!turbo && channel.due())
+                publish();
+        // the final layout always reaches the screen
+        publish();
+    }
+
+private:
+    double start_time = 0;
+    void publish() {
+        const Points &points = placer->positions();
+        const vector<double> &angles = placer->angles();
+        const Vectors &velocities = placer->velocities();
+        snapshot &buffer = channel.writing();
+        buffer.ttt.first.resize(points.size());
+        buffer.ttt.second.resize(points.size());
+        buffer.vel.resize(points.size());
+        for (int i = 0; i < points.size(); i++) {
+            buffer.ttt.first[i] = ITPLA::normalize_point(points[i], shape.edge / edge_length);
+            //        printf("%lf,%lf\n",angles[i],points[i].y);
+            buffer.ttt.second[i] = to_deg(angles[i]);
+            buffer.vel[i] = ITPLA::normalize_point(velocities[i], shape.edge / edge_length);
         }
+        buffer.K = placer->state().K;
+        buffer.E = placer->state().E;
+        buffer.frame = placer->state().frame;
+        buffer.run_time = clock() * 1.0 / CLOCKS_PER_SEC - start_time;
+        channel.publish();
     }
 } *pt;
 
@@ -79,12 +127,13 @@ MainWidget::MainWidget(QWidget *parent) :
     edge_length = 99.9533;
     polygon = LH;
 
-    normalized_polygon = normalize_polygon(polygon, edge_length / sqrt(3));
-    points = place(polygon, edge_length);
+    setFocusPolicy(Qt::StrongFocus);
+    placer = new Placer<SIDES>(polygon, edge_length);
+    pt = new placement_thread();
+    pt->channel.reserve(placer->positions().size());
     QTimer *timer = new QTimer();
     timer->start(1000.0 / FRAMES_PER_SEC);
     connect(timer, SIGNAL(timeout()), this, SLOT(repaint()));
-    pt = new placement_thread();
     pt->status = true;
     pt->start();
 //    pair<Points, vector<double> > t = place(tmp, edge_length);
@@ -98,24 +147,27 @@ void paint(QPaintDevice *qpd) {
     painter.setBackground(QBrush(Qt::white));
     painter.eraseRect(painter.window());
 
+    const Points &points = placer->positions();
+    const vector<double> &angles = placer->angles();
+    const Vectors &velocities = placer->velocities();
     pair<Points, vector<double> > ttt;
     Vectors vel;
     for (int i = 0; i < points.size(); i++) {
-        ttt.first.push_back(normalize_point(points[i]->GetPosition(), sqrt(3) / edge_length));
-//        printf("%lf,%lf\n",points[i]->GetAngle(),points[i]->GetPosition().y);
-        ttt.second.push_back(to_deg(points[i]->GetAngle()));
-        vel.push_back(normalize_point(points[i]->GetLinearVelocity(), sqrt(3) / edge_length));
+        ttt.first.push_back(normalize_point(points[i], shape.edge / edge_length));
+//        printf("%lf,%lf\n",angles[i],points[i].y);
+        ttt.second.push_back(to_deg(angles[i]));
+        vel.push_back(normalize_point(velocities[i], shape.edge / edge_length));
     }
     painter.setPen(Qt::black);
     painter.drawText(
                 0,
                 320,
-                QString().sprintf("Run Time:%8.3lfs", pt->run_time)
+                QString().sprintf("Run Time:%8.3lfs", pt->channel.reading().run_time)
     );
     painter.drawText(
                 0,
                 335,
-                QString().sprintf("Point:%d,Frame:%6d,Time:%8.3lfs,K:%.6lf", points.size(), frame, 1.0*frame/FRAMES_PER_SEC, ITPLA::K)
+                QString().sprintf("Point:%d,Frame:%6d,Time:%8.3lfs,K:%.6lf", points.size(), placer->state().frame, 1.0*placer->state().frame/FRAMES_PER_SEC, placer->state().K)
     );
     Points res = ttt.first;
     vector<double> ang = ttt.second;
@@ -126,18 +178,19 @@ void paint(QPaintDevice *qpd) {
         painter.drawLine(p1.x, p1.y, p2.x, p2.y);
     }
     painter.setPen(Qt::green);
-    double r = edge_length / 2 / sqrt(3);
+    // apothem and circumradius of a module on screen
+    double r = edge_length / shape.edge * shape.apothem,
+           R = edge_length / shape.edge;
     for (int i = 0; i < res.size(); i++)
         painter.drawEllipse(res[i].x - r, res[i].y - r, 2 * r, 2 * r);
     painter.setPen(Qt::red);
     for (int i = 0; i < ang.size(); i++) {
         painter.setPen(i == attention || attention == -1 ? Qt::red : Qt::white);
-        double a = to_rad(ang[i]);
-        double ttt = to_rad(120);
         Point &p = res[i];
-        painter.drawLine(p.x, p.y, p.x + r * sin(a), p.y + r * cos(a));
-        painter.drawLine(p.x, p.y, p.x + r * sin(a + ttt), p.y + r * cos(a + ttt));
-        painter.drawLine(p.x, p.y, p.x + r * sin(a + 2 * ttt), p.y + r * cos(a + 2 * ttt));
+        for (int k = 0; k < SIDES; k++) {
+            double a = to_rad(ang[i] + k * shape.side_angle);
+            painter.drawLine(p.x, p.y, p.x + r * sin(a), p.y + r * cos(a));
+        }
     }
     painter.setPen(Qt::black);
     for (int i = 0; i < points.size(); i++) {
@@ -148,15 +201,12 @@ void paint(QPaintDevice *qpd) {
     painter.setPen(Qt::blue);
     for (int i = 0; i < ang.size(); i++) {
         painter.setPen(i == attention || attention == -1 ? Qt::blue : Qt::white);
-        double a = to_rad(ang[i] + 60);
-        double ttt = to_rad(120);
-        Point &p = res[i],
-               p0 = b2Vec2(p.x + 2 * r * sin(a), p.y + 2 * r * cos(a)),
-               p1 = b2Vec2(p.x + 2 * r * sin(a + ttt), p.y + 2 * r * cos(a + ttt)),
-               p2 = b2Vec2(p.x + 2 * r * sin(a + 2 * ttt), p.y + 2 * r * cos(a + 2 * ttt));
-        painter.drawLine(p0.x, p0.y, p1.x, p1.y);
-        painter.drawLine(p1.x, p1.y, p2.x, p2.y);
-        painter.drawLine(p2.x, p2.y, p0.x, p0.y);
+        Point &p = res[i];
+        for (int k = 0; k < SIDES; k++) {
+            double a0 = to_rad(ang[i] - (2 * k + 1) * 180.0 / SIDES),
+                   a1 = to_rad(ang[i] - (2 * k + 3) * 180.0 / SIDES);
+            painter.drawLine(p.x + R * sin(a0), p.y + R * cos(a0), p.x + R * sin(a1), p.y + R * cos(a1));
+        }
     }
     painter.setPen(Qt::white);
     for (int i = 0; i < res.size(); i++)
@@ -173,45 +223,43 @@ void MainWidget::paintEvent(QPaintEvent *) {
     if (!output && pt->isFinished()) {
         QPixmap qi(this->width(), this->height());
         paint(&qi);
-        qi.save(QString().sprintf("/Users/zero/%d.png", stime));
+        qi.save(QString().sprintf("/Users/zero/%d.png", int(placer->state().stime)));
         output = true;
     }
     QPainter painter(this);
 
 #if 1
-    pt->lock.lock();
-    int reading = 0;
-    while (reading < 2 && pt->buffer[reading].status != -1)
-        reading++;
-    int idle = 0;
-    while (idle < 2 && pt->buffer[idle].status)
-        idle++;
-    pt->buffer[reading].status = 0;
-    pt->buffer[idle].status = -1;
-    pt->lock.unlock();
-
-    pair<Points, vector<double> > &ttt = pt->buffer[idle].ttt;
-    Vectors &vel = pt->buffer[idle].vel;
-    double K = pt->buffer[idle].K,
-            E = pt->buffer[idle].E;
+    const snapshot &buffer = pt->channel.reading();
+    const pair<Points, vector<double> > &ttt = buffer.ttt;
+    const Vectors &vel = buffer.vel;
+    double K = buffer.K,
+            E = buffer.E,
+            run_time = buffer.run_time;
+    int frame = buffer.frame;
 #else
+    const Points &points = placer->positions();
+    const vector<double> &angles = placer->angles();
+    const Vectors &velocities = placer->velocities();
     pair<Points, vector<double> > ttt;
     Vectors vel;
     for (int i = 0; i < points.size(); i++) {
-        ttt.first.push_back(normalize_point(points[i]->GetPosition(), sqrt(3) / edge_length));
-//        printf("%lf,%lf\n",points[i]->GetAngle(),points[i]->GetPosition().y);
-        ttt.second.push_back(to_deg(points[i]->GetAngle()));
-        vel.push_back(normalize_point(points[i]->GetLinearVelocity(), sqrt(3) / edge_length));
+        ttt.first.push_back(normalize_point(points[i], shape.edge / edge_length));
+//        printf("%lf,%lf\n",angles[i],points[i].y);
+        ttt.second.push_back(to_deg(angles[i]));
+        vel.push_back(normalize_point(velocities[i], shape.edge / edge_length));
     }
-    calc_next_step(normalized_polygon, points);
+    double K = placer->state().K,
+            E = placer->state().E,
+            run_time = 0;
+    int frame = placer->state().frame;
     //    if (time++ < 120)
-            points.back()->GetWorld()->Step(1.0 / 60, 6, 2);
+            placer->step();
 #endif
     painter.setPen(Qt::black);
     painter.drawText(
                 0,
                 305,
-                QString().sprintf("Run Time:%8.3lfs", pt->run_time)
+                QString().sprintf("Run Time:%8.3lfs%s", run_time, turbo ? " (turbo, T shows the frames again)" : "")
     );
     painter.drawText(
                 0,
@@ -237,18 +285,19 @@ void MainWidget::paintEvent(QPaintEvent *) {
         painter.drawLine(p1.x, p1.y, p2.x, p2.y);
     }
     painter.setPen(Qt::green);
-    double r = edge_length / 2 / sqrt(3);
+    // apothem and circumradius of a module on screen
+    double r = edge_length / shape.edge * shape.apothem,
+           R = edge_length / shape.edge;
     for (int i = 0; i < res.size(); i++)
         painter.drawEllipse(res[i].x - r, res[i].y - r, 2 * r, 2 * r);
     painter.setPen(Qt::red);
     for (int i = 0; i < ang.size(); i++) {
         painter.setPen(i == attention || attention == -1 ? Qt::red : Qt::white);
-        double a = to_rad(ang[i]);
-        double ttt = to_rad(120);
         Point &p = res[i];
-        painter.drawLine(p.x, p.y, p.x + r * sin(a), p.y + r * cos(a));
-        painter.drawLine(p.x, p.y, p.x + r * sin(a + ttt), p.y + r * cos(a + ttt));
-        painter.drawLine(p.x, p.y, p.x + r * sin(a + 2 * ttt), p.y + r * cos(a + 2 * ttt));
+        for (int k = 0; k < SIDES; k++) {
+            double a = to_rad(ang[i] + k * shape.side_angle);
+            painter.drawLine(p.x, p.y, p.x + r * sin(a), p.y + r * cos(a));
+        }
     }
     painter.setPen(Qt::black);
     for (int i = 0; i < res.size(); i++) {
@@ -259,15 +308,12 @@ void MainWidget::paintEvent(QPaintEvent *) {
     painter.setPen(Qt::blue);
     for (int i = 0; i < ang.size(); i++) {
         painter.setPen(i == attention || attention == -1 ? Qt::blue : Qt::white);
-        double a = to_rad(ang[i] + 60);
-        double ttt = to_rad(120);
-        Point &p = res[i],
-               p0 = b2Vec2(p.x + 2 * r * sin(a), p.y + 2 * r * cos(a)),
-               p1 = b2Vec2(p.x + 2 * r * sin(a + ttt), p.y + 2 * r * cos(a + ttt)),
-               p2 = b2Vec2(p.x + 2 * r * sin(a + 2 * ttt), p.y + 2 * r * cos(a + 2 * ttt));
-        painter.drawLine(p0.x, p0.y, p1.x, p1.y);
-        painter.drawLine(p1.x, p1.y, p2.x, p2.y);
-        painter.drawLine(p2.x, p2.y, p0.x, p0.y);
+        Point &p = res[i];
+        for (int k = 0; k < SIDES; k++) {
+            double a0 = to_rad(ang[i] - (2 * k + 1) * 180.0 / SIDES),
+                   a1 = to_rad(ang[i] - (2 * k + 3) * 180.0 / SIDES);
+            painter.drawLine(p.x + R * sin(a0), p.y + R * cos(a0), p.x + R * sin(a1), p.y + R * cos(a1));
+        }
     }
 //    painter.setPen(Qt::yellow);
 //    for (int i = 0; i < res.size(); i++) {
@@ -284,8 +330,16 @@ void MainWidget::paintEvent(QPaintEvent *) {
         painter.drawRect(res[i].x - 1, res[i].y - 1, 2, 2);
 }
 
+void MainWidget::keyPressEvent(QKeyEvent *event) {
+    if (event->key() == Qt::Key_T)
+        turbo = !turbo;
+    else
+        QWidget::keyPressEvent(event);
+}
+
 MainWidget::~MainWidget() {
     pt->status = false;
     while (pt->isRunning());
     delete pt;
+    delete placer;
 }
@@ -11,6 +11,7 @@ public:
     ~MainWidget();
 private:
     void paintEvent(QPaintEvent *);
+    void keyPressEvent(QKeyEvent *event);
 signals:
 
 public slots:
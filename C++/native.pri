@@ -0,0 +1,3 @@
+# qmake CONFIG+=native builds for the host cpu, which turns on the AVX2 force kernel; no fused multiply-adds,
+# so forces and layouts stay the same as in the default build
+native: QMAKE_CXXFLAGS += -march=native -ffp-contract=off
@@ -0,0 +1,66 @@
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "ITPLA.h"
+
+// the switches of ITPLA::Options, shared by the command line programs
+namespace ITPLA {
+
+// for the synopsis line of a usage message
+const char *const OPTION_SYNOPSIS = "[-l] [-b] [-L] [-z] [-x] [-m sizes] [-k K]";
+
+// one line per switch, the descriptions start width columns after the indent
+void option_usage(const int width) {
+    fprintf(stderr, "  %-*sstart from the best clipped triangular tiling instead of random poses\n", width, "-l");
+    fprintf(stderr, "  %-*sdelete several modules per plateau while K < 0.7\n", width, "-b");
+    fprintf(stderr, "  %-*safter a deletion move only the modules around the hole until it settles\n", width, "-L");
+    fprintf(stderr, "  %-*sput modules at rest to sleep and skip them until a moving neighbour pushes them\n", width, "-z");
+    fprintf(stderr, "  %-*sexact touching distances between modules and to the border instead of the estimate\n", width, "-x");
+    fprintf(stderr, "  %-*ssmaller module sizes relative to the edge length, e.g. 0.6,0.4; modules of these\n", width, "-m sizes");
+    fprintf(stderr, "  %-*ssizes replace deleted modules and fill the space left; size:priority offers a size\n", width, "");
+    fprintf(stderr, "  %-*sbefore those of lower priority (default: 0, the larger size first among equal ones)\n", width, "");
+    fprintf(stderr, "  %-*skeep such a module only if the plateau after it ends with K >= this (default: 0.85)\n", width, "-k K");
+}
+
+// reads the switch at argv[i] into options, i ends on its last argument; false if argv[i] is none of them.
+// A malformed argument goes to usage, which does not return
+bool parse_option(const int argc, char *argv[], int &i, Options &options, void (*usage)(const char *)) {
+    if (!strcmp(argv[i], "-l"))
+        options.lattice_start = true;
+    else if (!strcmp(argv[i], "-b"))
+        options.batch_delete = true;
+    else if (!strcmp(argv[i], "-L"))
+        options.local_relax = true;
+    else if (!strcmp(argv[i], "-z"))
+        options.sleep_modules = true;
+    else if (!strcmp(argv[i], "-x"))
+        options.exact_distance = true;
+    else if (!strcmp(argv[i], "-m") && i + 1 < argc) {
+        vector<double> &palette = options.size_palette,
+                       &priority = options.size_priority;
+        palette.clear();
+        priority.clear();
+        for (char *size = strtok(argv[++i], ","); size != NULL; size = strtok(NULL, ",")) {
+            const char *colon = strchr(size, ':');
+            palette.push_back(atof(size));
+            priority.push_back(colon != NULL ? atof(colon + 1) : 0);
+            if (palette.back() <= 0 || 1 <= palette.back())
+                usage(argv[0]);
+        }
+        if (palette.empty())
+            usage(argv[0]);
+    } else if (!strcmp(argv[i], "-k") && i + 1 < argc) {
+        options.keep_K = atof(argv[++i]);
+        if (options.keep_K <= 0)
+            usage(argv[0]);
+    } else
+        return false;
+    return true;
+}
+
+}
+
+#endif // OPTIONS_H
@@ -21,8 +21,11 @@ HEADERS  += mainwindow.h \
 
 FORMS    += mainwindow.ui
 
+include(native.pri)
+
 win32 {
-    QMAKE_CXXFLAGS += -std=c++11 -O2 -frounding-math
+    QMAKE_CXXFLAGS += -std=c++11 -O2 -frounding-math -fopenmp
+    LIBS += -fopenmp
     INCLUDEPATH += D:/Software/CGAL-4.5.2/include/
     LIBS += -lCGAL -lCGAL_Core -lgmp
     INCLUDEPATH += D:/
@@ -30,7 +33,8 @@ win32 {
 }
 
 unix:!macx {
-    QMAKE_CXXFLAGS += -std=c++11 -O2 -frounding-math
+    QMAKE_CXXFLAGS += -std=c++11 -O2 -frounding-math -pthread -fopenmp
+    LIBS += -pthread -fopenmp
     LIBS += -lCGAL -lCGAL_Core -lgmp
     INCLUDEPATH += /mnt/Zero_Data
     LIBS += -L"/mnt/Zero_Data/Box2D" -lBox2D
@@ -0,0 +1,22 @@
+#!/bin/sh
+# checks the closed-form overlap kernels against CGAL on every shipped border:
+# check_kernels.sh path/to/benchmark [frames], with the benchmark built by qmake CONFIG+=checkkernels
+BENCHMARK=${1:-../benchmark}
+FRAMES=${2:-3000}
+LOG=$(mktemp)
+
+"$BENCHMARK" /dev/null -s 1 -n 2 -f "$FRAMES" > /dev/null 2> "$LOG"
+if ! grep -q "CGAL calls checked" "$LOG"; then
+    echo "FAIL $BENCHMARK was not built with CONFIG+=checkkernels"
+    FAILED=1
+elif grep -q "kernel disagrees with CGAL" "$LOG"; then
+    grep "kernel disagrees with CGAL" "$LOG" | sort | uniq -c
+    echo "FAIL kernels: $(grep -c "kernel disagrees with CGAL" "$LOG") disagreements, $(grep "CGAL calls checked" "$LOG")"
+    FAILED=1
+else
+    echo "ok   kernels: $(grep "CGAL calls checked" "$LOG")"
+    FAILED=0
+fi
+
+rm -f "$LOG"
+exit $FAILED
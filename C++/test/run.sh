@@ -0,0 +1,109 @@
+#!/bin/sh
+# checks of the headless build: run.sh path/to/headless
+HEADLESS=${1:-../headless}
+DIR=$(dirname "$0")
+OUT=$(mktemp)
+FULL=$(mktemp)
+TRACE=$(mktemp)
+LOG=$(mktemp)
+CHECKPOINT=$(mktemp -u)
+FAILED=0
+
+# a border too small for a single module converges at once with an empty layout
+if ! timeout 60 "$HEADLESS" "$DIR/tiny.txt" 100 "$OUT" -s 1 > /dev/null; then
+    echo "FAIL tiny.txt: no convergence"
+    FAILED=1
+elif [ -s "$OUT" ]; then
+    echo "FAIL tiny.txt: modules placed"
+    FAILED=1
+else
+    echo "ok   tiny.txt"
+fi
+
+# several runs on their own threads must all finish as well
+if ! timeout 60 "$HEADLESS" "$DIR/tiny.txt" 100 "$OUT" -s 1 -n 4 -j 4 > /dev/null; then
+    echo "FAIL tiny.txt -n 4: no convergence"
+    FAILED=1
+else
+    echo "ok   tiny.txt -n 4"
+fi
+
+# a palette module that does not reach -k is taken out again, the run goes on from the layout before it
+if ! timeout 60 "$HEADLESS" "$DIR/triangle.txt" 100 "$OUT" -s 1 -m 0.5 -k 1.5 -t "$TRACE" -T 1000000 > /dev/null; then
+    echo "FAIL triangle.txt -k: no convergence"
+    FAILED=1
+elif ! awk -F, '$10 == "insert" { i = 1 } $10 == "reject" && i { r = 1 } END { exit !r }' "$TRACE"; then
+    echo "FAIL triangle.txt -k: no insert taken back"
+    FAILED=1
+elif awk '$4 != 1 { bad = 1 } END { exit !bad }' "$OUT"; then
+    echo "FAIL triangle.txt -k: palette module kept"
+    FAILED=1
+else
+    echo "ok   triangle.txt -k"
+fi
+
+# the hole of a module deleted at K >= 0.7 takes a palette module, which is taken out again when the plateau
+# ends below 0.85; once converged, modules of both sizes go into the space left and stay
+if ! timeout 60 "$HEADLESS" "$DIR/triangle.txt" 100 "$FULL" -s 1 -m 0.5,0.7 -t "$TRACE" -T 1000000 > /dev/null; then
+    echo "FAIL triangle.txt -m: no convergence"
+    FAILED=1
+elif ! awk -F, 'last == "delete" && modules <= $3 && $10 == "reject" { r = 1 } { last = $10; modules = $3 } END { exit !r }' "$TRACE"; then
+    echo "FAIL triangle.txt -m: no refill taken back"
+    FAILED=1
+elif ! grep -q "0\.500000" "$FULL" || ! grep -q "0\.700000" "$FULL"; then
+    echo "FAIL triangle.txt -m: palette modules missing"
+    FAILED=1
+else
+    echo "ok   triangle.txt -m"
+fi
+
+# a size of higher priority is offered first, so 0.5 takes the room 0.7 got above
+if ! timeout 60 "$HEADLESS" "$DIR/triangle.txt" 100 "$OUT" -s 1 -m 0.7,0.5:1 > /dev/null; then
+    echo "FAIL triangle.txt -m priority: no convergence"
+    FAILED=1
+elif ! grep -q "0\.500000" "$OUT" || grep -q "0\.700000" "$OUT"; then
+    echo "FAIL triangle.txt -m priority: 0.7 offered first"
+    FAILED=1
+else
+    echo "ok   triangle.txt -m priority"
+fi
+
+# a run killed halfway resumes from its checkpoint and ends with the layout of the uninterrupted one
+timeout 0.5 "$HEADLESS" "$DIR/triangle.txt" 100 "$OUT" -s 1 -m 0.5,0.7 -c "$CHECKPOINT" -e 1000 > /dev/null
+timeout 60 "$HEADLESS" "$DIR/triangle.txt" 100 "$OUT" -s 1 -m 0.5,0.7 -c "$CHECKPOINT" -e 1000 > "$LOG"
+if ! grep -q resumed "$LOG"; then
+    echo "FAIL triangle.txt -c: not resumed"
+    FAILED=1
+elif ! cmp -s "$OUT" "$FULL"; then
+    echo "FAIL triangle.txt -c: resumed layout differs"
+    FAILED=1
+else
+    echo "ok   triangle.txt -c"
+fi
+
+# a truncated checkpoint is ignored, the run starts over
+head -c 64 "$CHECKPOINT" > "$CHECKPOINT.cut" && mv "$CHECKPOINT.cut" "$CHECKPOINT"
+timeout 60 "$HEADLESS" "$DIR/triangle.txt" 100 "$OUT" -s 1 -m 0.5,0.7 -c "$CHECKPOINT" > "$LOG"
+if grep -q resumed "$LOG"; then
+    echo "FAIL triangle.txt -c truncated: resumed"
+    FAILED=1
+elif ! cmp -s "$OUT" "$FULL"; then
+    echo "FAIL triangle.txt -c truncated: layout differs"
+    FAILED=1
+else
+    echo "ok   triangle.txt -c truncated"
+fi
+
+# with 20 modules a batch deletion takes out two at once
+if ! timeout 120 "$HEADLESS" "$DIR/square.txt" 100 "$OUT" -s 2 -b -t "$TRACE" -T 1000000 > /dev/null; then
+    echo "FAIL square.txt -b: no convergence"
+    FAILED=1
+elif ! awk -F, '$3 <= modules - 2 { b = 1 } { modules = $3 } END { exit !b }' "$TRACE"; then
+    echo "FAIL square.txt -b: one module per deletion"
+    FAILED=1
+else
+    echo "ok   square.txt -b"
+fi
+
+rm -f "$OUT" "$FULL" "$TRACE" "$LOG" "$CHECKPOINT" "$CHECKPOINT.tmp"
+exit $FAILED